@@ -0,0 +1,193 @@
+/**
+ * @file codec_bench.c
+ *
+ * D-Bus frame codec micro-benchmark: encodes and decodes the same commands
+ * in the legacy (siiv) array format and in the compact byte array format,
+ * and reports the cost per frame and the marshalled message size.
+ *
+ * Usage: codec-bench [iterations]
+ *
+ * Two commands are measured: a single registered integer entry, as sent
+ * for most requests, and a full Wi-Fi access point list keyed by SSID.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <dbus/dbus.h>
+
+#include "util.h"
+#include "comm/cmd_payload.h"
+#include "comm/dbus_comm.h"
+#include "comm/frame_codec.h"
+#include "main.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEF_ITERATIONS                  100000
+#define AP_LIST_SIZE                    32
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct {
+    double encode_ns;
+    double decode_ns;
+    int32_t size;
+} codec_result_t;
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char *fmt_name[] = {
+    [FRAME_FMT_LEGACY]              = "legacy",
+    [FRAME_FMT_COMPACT]             = "compact",
+};
+
+static ctx_t bench_ctx;
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static DBusMessage *new_frame(const remote_cmd_t *cmd, frame_fmt_t fmt)
+{
+    DBusMessage *msg;
+
+    msg = dbus_message_new_signal(SER_OBJ_PATH, SER_IFACE, SER_SIG);
+    if (!msg)
+        return NULL;
+
+    if (encode_data_frame(msg, cmd, fmt) != (int32_t)fmt) {
+        dbus_message_unref(msg);
+        return NULL;
+    }
+
+    return msg;
+}
+
+static int32_t run_codec(const remote_cmd_t *cmd, frame_fmt_t fmt, \
+                         int32_t iterations, codec_result_t *res)
+{
+    remote_cmd_t *out;
+    DBusMessage *msg;
+    uint64_t start;
+    char *wire;
+    int32_t i;
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        msg = new_frame(cmd, fmt);
+        if (!msg)
+            return -1;
+        dbus_message_unref(msg);
+    }
+    res->encode_ns = (double)(now_ns() - start) / iterations;
+
+    /* Decode the message as it is received: marshalled by the sender */
+    msg = new_frame(cmd, fmt);
+    if (!msg)
+        return -1;
+
+    dbus_message_set_serial(msg, 1);
+    if (!dbus_message_marshal(msg, &wire, &res->size)) {
+        dbus_message_unref(msg);
+        return -1;
+    }
+    dbus_message_unref(msg);
+
+    msg = dbus_message_demarshal(wire, res->size, NULL);
+    dbus_free(wire);
+    if (!msg)
+        return -1;
+
+    out = create_remote_cmd();
+    if (!out) {
+        dbus_message_unref(msg);
+        return -1;
+    }
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        if (decode_data_frame(msg, out) != (int32_t)fmt)
+            break;
+    }
+    res->decode_ns = (double)(now_ns() - start) / iterations;
+    dbus_message_unref(msg);
+
+    if (i != iterations || out->entry_count != cmd->entry_count || \
+        out->umid != cmd->umid)
+        i = -1;
+
+    delete_remote_cmd(out);
+    return i == iterations ? 0 : -1;
+}
+
+static void bench_cmd(const char *name, const remote_cmd_t *cmd, \
+                      int32_t iterations)
+{
+    codec_result_t res;
+    frame_fmt_t fmt;
+
+    for (fmt = FRAME_FMT_LEGACY; fmt <= FRAME_FMT_COMPACT; fmt++) {
+        if (run_codec(cmd, fmt, iterations, &res)) {
+            printf("%-10s %-8s: failed\n", name, fmt_name[fmt]);
+            continue;
+        }
+
+        printf("%-10s %-8s: encode %7.0f ns  decode %7.0f ns  %5d bytes\n", \
+               name, fmt_name[fmt], res.encode_ns, res.decode_ns, res.size);
+    }
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+ctx_t *get_ctx()
+{
+    return &bench_ctx;
+}
+
+int32_t process_opcode(uint32_t opcode, void *data)
+{
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int32_t iterations = argc > 1 ? atoi(argv[1]) : DEF_ITERATIONS;
+    remote_cmd_t *cmd;
+    char ssid[24];
+    int32_t i;
+
+    if (iterations <= 0)
+        return 1;
+
+    cmd = create_remote_task_data(WORK_PRIO_NORMAL, WORK_DURATION_SHORT, \
+                                  OP_ADJUST_BRIGHTNESS);
+    if (!cmd)
+        return 1;
+    remote_cmd_add_i32(cmd, KEY_BRIGHTNESS, 80);
+    bench_cmd("single", cmd, iterations);
+    delete_remote_cmd(cmd);
+
+    cmd = create_remote_task_data(WORK_PRIO_NORMAL, WORK_DURATION_SHORT, \
+                                  OP_WIFI_AP_LIST);
+    if (!cmd)
+        return 1;
+    for (i = 0; i < AP_LIST_SIZE; i++) {
+        snprintf(ssid, sizeof(ssid), "access-point-%02d", i);
+        remote_cmd_add_int(cmd, ssid, -40 - i);
+    }
+    bench_cmd("ap-list", cmd, iterations);
+    delete_remote_cmd(cmd);
+
+    return 0;
+}
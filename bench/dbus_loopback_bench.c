@@ -0,0 +1,582 @@
+/**
+ * @file dbus_loopback_bench.c
+ *
+ * D-Bus transport load generator: starts a private dbus-daemon, runs the
+ * real DBus listener of the service against it and a fake sys-mgr that
+ * emits SysSig frames at fixed rates. Every frame carries its emission
+ * time, so the run reports how long each stream takes to reach its handler
+ * and then the UI thread, at the given load.
+ *
+ * Usage: dbus-loopback-bench [seconds] [imu hz] [ap list hz] [ap entries]
+ *                            [backlight hz] [legacy]
+ *
+ * Streams are routed as in the service: IMU reports are coalesced and
+ * dropped under load, AP lists coalesced, backlight states queued. The UI
+ * thread drains the UI lane every UI_FRAME_US, like the main loop.
+ *
+ * Columns, in us:
+ *   to-handler  emission to handler start: bus, decode, dispatch and wait
+ *   wait        push to handler start, the workqueue part of the above
+ *   handler     handler run time
+ *   to-ui       emission to the UI callback, the UI lane included
+ * A rate too high for the service shows as growing latencies, then as
+ * frames coalesced or dropped (handled < sent).
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <dbus/dbus.h>
+
+#include "util.h"
+#include "comm/cmd_payload.h"
+#include "comm/dbus_comm.h"
+#include "comm/frame_codec.h"
+#include "comm/f_comm.h"
+#include "sched/op_handler.h"
+#include "sched/workqueue.h"
+#include "sched/wq_stats.h"
+#include "ui/ui_lane.h"
+#include "main.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEF_SECONDS                     5
+#define DEF_IMU_HZ                      100
+#define DEF_AP_HZ                       2
+#define DEF_AP_ENTRIES                  32
+#define DEF_BACKLIGHT_HZ                10
+
+#define UI_FRAME_US                     5000
+#define BUS_START_TIMEOUT_MS            5000
+#define TS_KEY                          "bench_ts"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+enum {
+    STREAM_IMU = 0,
+    STREAM_AP_LIST,
+    STREAM_BACKLIGHT,
+    NR_STREAMS,
+};
+
+typedef struct {
+    const char *name;
+    uint32_t opcode;
+    uint32_t flags;                     /* Route, as in task_exec.c */
+    int32_t hz;
+    uint64_t next_ns;
+    uint32_t sent;
+    atomic_uint handled;
+    atomic_uint shown;
+    wq_hist_t to_handler;
+    wq_hist_t to_ui;
+} stream_t;
+
+/* Posted to the UI lane by a handler */
+typedef struct {
+    stream_t *stream;
+    uint64_t emit_ns;
+} ui_stamp_t;
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static ctx_t bench_ctx;
+static pid_t bus_pid;
+static char bus_dir[] = "/tmp/dbus-bench-XXXXXX";
+
+static uint64_t peer_end_ns;
+static int32_t ap_entries = DEF_AP_ENTRIES;
+static frame_fmt_t frame_fmt = FRAME_FMT_COMPACT;
+
+static stream_t streams[NR_STREAMS] = {
+    [STREAM_IMU] = {
+        .name = "imu",
+        .opcode = OP_IMU_STATE,
+        .flags = OP_F_COALESCE | OP_F_DROPPABLE,
+        .hz = DEF_IMU_HZ,
+    },
+    [STREAM_AP_LIST] = {
+        .name = "ap-list",
+        .opcode = OP_WIFI_AP_LIST,
+        .flags = OP_F_COALESCE,
+        .hz = DEF_AP_HZ,
+    },
+    [STREAM_BACKLIGHT] = {
+        .name = "backlight",
+        .opcode = OP_BACKLIGHT_STATE,
+        .hz = DEF_BACKLIGHT_HZ,
+    },
+};
+
+static op_entry_t bench_handlers[NR_STREAMS];
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void sleep_until_ns(uint64_t t)
+{
+    struct timespec ts = {
+        .tv_sec = t / NSEC_PER_SEC,
+        .tv_nsec = t % NSEC_PER_SEC,
+    };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static stream_t *stream_of(uint32_t opcode)
+{
+    int32_t i;
+
+    for (i = 0; i < NR_STREAMS; i++) {
+        if (streams[i].opcode == opcode)
+            return &streams[i];
+    }
+
+    return NULL;
+}
+
+/*=====================
+ * Private bus
+ *====================*/
+/* Start dbus-daemon on a socket in bus_dir, return its address */
+static char *start_bus(void)
+{
+    static char addr[256];
+    char conf[64], fd_arg[32];
+    int32_t pfd[2];
+    ssize_t len;
+    FILE *f;
+
+    if (!mkdtemp(bus_dir))
+        return NULL;
+
+    snprintf(conf, sizeof(conf), "%s/bus.conf", bus_dir);
+    f = fopen(conf, "w");
+    if (!f)
+        return NULL;
+
+    fprintf(f, "<!DOCTYPE busconfig PUBLIC "
+               "\"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\" "
+               "\"http://www.freedesktop.org/standards/dbus/1.0/"
+               "busconfig.dtd\">\n"
+               "<busconfig>\n"
+               "  <type>session</type>\n"
+               "  <listen>unix:dir=%s</listen>\n"
+               "  <auth>EXTERNAL</auth>\n"
+               "  <policy context=\"default\">\n"
+               "    <allow send_destination=\"*\"/>\n"
+               "    <allow receive_sender=\"*\"/>\n"
+               "    <allow own=\"*\"/>\n"
+               "    <allow user=\"*\"/>\n"
+               "  </policy>\n"
+               "  <limit name=\"max_replies_per_connection\">100000</limit>\n"
+               "  <limit name=\"max_incoming_bytes\">1000000000</limit>\n"
+               "  <limit name=\"max_outgoing_bytes\">1000000000</limit>\n"
+               "</busconfig>\n", bus_dir);
+    fclose(f);
+
+    if (pipe(pfd))
+        return NULL;
+
+    bus_pid = fork();
+    if (bus_pid < 0)
+        return NULL;
+
+    if (!bus_pid) {
+        close(pfd[0]);
+        snprintf(fd_arg, sizeof(fd_arg), "--print-address=%d", pfd[1]);
+        snprintf(addr, sizeof(addr), "--config-file=%s", conf);
+        execlp("dbus-daemon", "dbus-daemon", "--nofork", addr, fd_arg, \
+               (char *)NULL);
+        _exit(127);
+    }
+
+    close(pfd[1]);
+    len = read(pfd[0], addr, sizeof(addr) - 1);
+    close(pfd[0]);
+    if (len <= 0)
+        return NULL;
+
+    addr[len] = '\0';
+    addr[strcspn(addr, "\n")] = '\0';
+    return addr;
+}
+
+static void stop_bus(void)
+{
+    char path[64];
+
+    if (bus_pid > 0) {
+        kill(bus_pid, SIGTERM);
+        waitpid(bus_pid, NULL, 0);
+    }
+
+    snprintf(path, sizeof(path), "%s/bus.conf", bus_dir);
+    unlink(path);
+    rmdir(bus_dir);
+}
+
+/*=====================
+ * Fake sys-mgr
+ *====================*/
+static DBusConnection *connect_peer(const char *addr)
+{
+    DBusConnection *conn;
+    DBusError err;
+
+    dbus_error_init(&err);
+    conn = dbus_connection_open_private(addr, &err);
+    if (!conn || !dbus_bus_register(conn, &err)) {
+        LOG_ERROR("Peer connection failed: %s", err.message);
+        dbus_error_free(&err);
+        return NULL;
+    }
+
+    dbus_bus_request_name(conn, REMOTE_SER_NAME, 0, &err);
+    if (dbus_error_is_set(&err)) {
+        LOG_ERROR("Peer name request failed: %s", err.message);
+        dbus_error_free(&err);
+        dbus_connection_close(conn);
+        dbus_connection_unref(conn);
+        return NULL;
+    }
+
+    return conn;
+}
+
+static int32_t add_stamp(remote_cmd_t *cmd, uint64_t emit_ns)
+{
+    payload_t *entry;
+
+    entry = remote_cmd_new_entry(cmd);
+    if (!entry)
+        return -ENOMEM;
+
+    entry->key = TS_KEY;
+    entry->data_type = DBUS_TYPE_DOUBLE;
+    entry->data_length = sizeof(double);
+    entry->value.dbl = (double)emit_ns;
+    return 0;
+}
+
+static void fill_frame(remote_cmd_t *cmd, int32_t stream, uint32_t seq)
+{
+    char ssid[24];
+    int32_t i;
+
+    switch (stream) {
+    case STREAM_IMU:
+        remote_cmd_add_i32(cmd, KEY_IMU_ENABLE, 1);
+        remote_cmd_add_i32(cmd, KEY_IMU_ROLL, (int32_t)(seq % 90));
+        remote_cmd_add_i32(cmd, KEY_IMU_PITCH, 0);
+        remote_cmd_add_i32(cmd, KEY_IMU_YAW, 0);
+        break;
+    case STREAM_AP_LIST:
+        for (i = 0; i < ap_entries; i++) {
+            snprintf(ssid, sizeof(ssid), "access-point-%02d", i);
+            remote_cmd_add_int(cmd, ssid, -40 - i);
+        }
+        break;
+    case STREAM_BACKLIGHT:
+        remote_cmd_add_i32(cmd, KEY_ALS_ENABLE, 0);
+        remote_cmd_add_i32(cmd, KEY_BRIGHTNESS, (int32_t)(seq % 100));
+        break;
+    }
+}
+
+static int32_t emit_frame(DBusConnection *conn, int32_t stream)
+{
+    stream_t *s = &streams[stream];
+    remote_cmd_t *cmd;
+    DBusMessage *msg;
+    int32_t ret = -ENOMEM;
+
+    cmd = create_remote_cmd();
+    if (!cmd)
+        return -ENOMEM;
+
+    remote_cmd_init(cmd, "SYS-MGR", s->sent + 1, s->opcode, \
+                    WORK_PRIO_NORMAL, WORK_DURATION_SHORT);
+    fill_frame(cmd, stream, s->sent);
+
+    msg = dbus_message_new_signal(LISTEN_OBJ_PATH, LISTEN_IFACE, LISTEN_SIG);
+    if (msg && !add_stamp(cmd, now_ns()) && \
+        encode_data_frame(msg, cmd, frame_fmt) >= 0 && \
+        dbus_connection_send(conn, msg, NULL)) {
+        s->sent++;
+        ret = 0;
+    }
+
+    if (msg)
+        dbus_message_unref(msg);
+    delete_remote_cmd(cmd);
+    return ret;
+}
+
+/* Emit every stream at its rate until @end_ns */
+static void run_peer(DBusConnection *conn, uint64_t end_ns)
+{
+    uint64_t now, next;
+    int32_t i;
+
+    now = now_ns();
+    for (i = 0; i < NR_STREAMS; i++)
+        streams[i].next_ns = now;
+
+    while ((now = now_ns()) < end_ns) {
+        next = end_ns;
+        for (i = 0; i < NR_STREAMS; i++) {
+            if (streams[i].hz <= 0)
+                continue;
+
+            if (streams[i].next_ns <= now) {
+                emit_frame(conn, i);
+                streams[i].next_ns += NSEC_PER_SEC / streams[i].hz;
+            }
+            if (streams[i].next_ns < next)
+                next = streams[i].next_ns;
+        }
+
+        dbus_connection_flush(conn);
+        sleep_until_ns(next);
+    }
+}
+
+static void *peer_thread(void *arg)
+{
+    run_peer(arg, peer_end_ns);
+    return NULL;
+}
+
+/*=====================
+ * Service side
+ *====================*/
+/* UI thread, the last hop of a frame */
+static void bench_ui_cb(void *arg)
+{
+    ui_stamp_t *stamp = arg;
+
+    wq_hist_record(&stamp->stream->to_ui, now_ns() - stamp->emit_ns);
+    atomic_fetch_add(&stamp->stream->shown, 1);
+    free(stamp);
+}
+
+/* Worker, stands for the handle_*() of the stream */
+static int32_t bench_handler(void *data)
+{
+    remote_cmd_t *cmd = data;
+    uint64_t emit_ns = 0;
+    ui_stamp_t *stamp;
+    stream_t *s;
+    uint32_t i;
+
+    s = stream_of(cmd->opcode);
+    if (!s)
+        return -EINVAL;
+
+    for (i = 0; i < cmd->entry_count; i++) {
+        if (!strcmp(cmd->entries[i].key, TS_KEY))
+            emit_ns = (uint64_t)cmd->entries[i].value.dbl;
+    }
+    if (!emit_ns)
+        return -EPROTO;
+
+    wq_hist_record(&s->to_handler, now_ns() - emit_ns);
+    atomic_fetch_add(&s->handled, 1);
+
+    stamp = malloc(sizeof(*stamp));
+    if (!stamp)
+        return -ENOMEM;
+
+    stamp->stream = s;
+    stamp->emit_ns = emit_ns;
+    if (ui_post(bench_ui_cb, stamp)) {
+        free(stamp);
+        return -EAGAIN;
+    }
+
+    return 0;
+}
+
+static int32_t register_handlers(void)
+{
+    int32_t i, ret;
+
+    for (i = 0; i < NR_STREAMS; i++) {
+        bench_handlers[i] = (op_entry_t) {
+            .opcode = streams[i].opcode,
+            .fn = bench_handler,
+            .wq = UI_WQ,
+            .prio = OP_PRIO_FRAME,
+            .flags = streams[i].flags,
+        };
+
+        ret = op_register(&bench_handlers[i]);
+        if (ret)
+            return ret;
+    }
+
+    return 0;
+}
+
+static void print_hist(const wq_hist_t *h)
+{
+    printf("  %6u %6u %6u", wq_hist_percentile(h, 50), \
+           wq_hist_percentile(h, 99), atomic_load(&h->max_us));
+}
+
+static void report(int32_t seconds)
+{
+    stream_t *s;
+    int32_t i;
+
+    printf("\n%-10s %5s %6s %7s %7s |%22s |%22s |%22s |%22s\n", "stream", \
+           "hz", "sent", "handled", "shown", "to-handler p50/p99/max", \
+           "wait p50/p99/max", "handler p50/p99/max", "to-ui p50/p99/max");
+
+    for (i = 0; i < NR_STREAMS; i++) {
+        s = &streams[i];
+        if (s->hz <= 0)
+            continue;
+
+        printf("%-10s %5d %6u %7u %7u |", s->name, s->hz, s->sent, \
+               atomic_load(&s->handled), atomic_load(&s->shown));
+        print_hist(&s->to_handler);
+        printf(" |");
+        print_hist(wq_stats_hist(s->opcode, WQ_HIST_WAIT));
+        printf(" |");
+        print_hist(wq_stats_hist(s->opcode, WQ_HIST_SERVICE));
+        printf(" |");
+        print_hist(&s->to_ui);
+        printf("\n");
+    }
+
+    printf("\n%s frames, %d AP entries, %d s\n", \
+           frame_fmt == FRAME_FMT_COMPACT ? "compact" : "legacy", \
+           ap_entries, seconds);
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+ctx_t *get_ctx()
+{
+    return &bench_ctx;
+}
+
+int32_t process_opcode(uint32_t opcode, void *data)
+{
+    return op_run(opcode, data);
+}
+
+int main(int argc, char **argv)
+{
+    int32_t seconds = argc > 1 ? atoi(argv[1]) : DEF_SECONDS;
+    DBusConnection *peer = NULL;
+    pthread_t listener, sender;
+    uint64_t deadline;
+    wq_conf_t conf;
+    char *addr;
+    int32_t ret = 1;
+
+    if (argc > 2)
+        streams[STREAM_IMU].hz = atoi(argv[2]);
+    if (argc > 3)
+        streams[STREAM_AP_LIST].hz = atoi(argv[3]);
+    if (argc > 4)
+        ap_entries = atoi(argv[4]);
+    if (argc > 5)
+        streams[STREAM_BACKLIGHT].hz = atoi(argv[5]);
+    if (argc > 6 && !strcmp(argv[6], "legacy"))
+        frame_fmt = FRAME_FMT_LEGACY;
+    if (seconds <= 0 || ap_entries < 0)
+        return 1;
+
+    addr = start_bus();
+    if (!addr) {
+        fprintf(stderr, "Failed to start dbus-daemon\n");
+        stop_bus();
+        return 1;
+    }
+    /* The listener connects to the system bus, point it to ours */
+    setenv("DBUS_SYSTEM_BUS_ADDRESS", addr, 1);
+
+    bench_ctx.run = 1;
+    INIT_LIST_HEAD(&bench_ctx.op.handler_lst);
+    workqueue_default_conf(&conf);
+    if (init_event_file(&bench_ctx) || workqueue_init(&conf) || \
+        ui_lane_init() || register_handlers())
+        goto out_bus;
+
+    peer = connect_peer(addr);
+    if (!peer)
+        goto out_wq;
+
+    if (pthread_create(&listener, NULL, dbus_fn_thread_handler, NULL))
+        goto out_wq;
+
+    deadline = now_ns() + BUS_START_TIMEOUT_MS * 1000000ULL;
+    while (!bench_ctx.comm.dbus_conn && now_ns() < deadline)
+        usleep(1000);
+    if (!bench_ctx.comm.dbus_conn) {
+        fprintf(stderr, "DBus listener did not connect\n");
+        goto out_listener;
+    }
+    /* Let the match rule reach the daemon before the first frame */
+    usleep(100000);
+
+    peer_end_ns = now_ns() + (uint64_t)seconds * NSEC_PER_SEC;
+    if (pthread_create(&sender, NULL, peer_thread, peer))
+        goto out_listener;
+
+    /* This thread is the UI thread, frames paced like the main loop */
+    while (now_ns() < peer_end_ns + 200 * 1000000ULL) {
+        ui_lane_drain();
+        usleep(UI_FRAME_US);
+    }
+    ui_lane_drain();
+
+    pthread_join(sender, NULL);
+    workqueue_drain(get_wq(UI_WQ), 1000);
+    ui_lane_drain();
+    report(seconds);
+    ret = 0;
+
+out_listener:
+    bench_ctx.run = 0;
+    event_set(bench_ctx.comm.event, SIGINT);
+    pthread_join(listener, NULL);
+out_wq:
+    bench_ctx.run = 0;
+    workqueue_deinit();
+    ui_lane_deinit();
+    op_unregister_all();
+    if (peer) {
+        dbus_connection_close(peer);
+        dbus_connection_unref(peer);
+    }
+out_bus:
+    cleanup_event_file(&bench_ctx);
+    stop_bus();
+    return ret;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file obj_teardown_bench.c
+ *
+ * Object tree teardown benchmark: builds the settings screen and the
+ * on-screen keyboard on a headless LVGL display, then measures how long
+ * removing each subtree takes, metadata and LVGL objects together.
+ *
+ * Usage: obj-teardown-bench [iterations]
+ *
+ * Each iteration builds the screen again, so the LVGL heap and the object
+ * pool go through the same allocation pattern as a window switch.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include <lvgl.h>
+#include "util.h"
+#include "ui/ui_core.h"
+#include "ui/screen.h"
+#include "ui/comps.h"
+#include "ui/windows.h"
+#include "sched/wq_stats.h"
+#include "main.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEF_ITERATIONS                  200
+#define DRAW_BUF_LINES                  10
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct {
+    const char *name;
+    uint32_t nr_objs;
+    uint64_t total_ns;
+    wq_hist_t hist;
+} teardown_result_t;
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static ctx_t bench_ctx;
+static uint8_t draw_buf[DISP_WIDTH * DRAW_BUF_LINES * 4];
+
+static teardown_result_t res_setting = { .name = "settings" };
+static teardown_result_t res_keyboard = { .name = "keyboard" };
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+/* Nothing is drawn, the display only gives the objects a screen */
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px)
+{
+    lv_display_flush_ready(disp);
+}
+
+static int32_t bench_ui_init(ctx_t *ctx)
+{
+    lv_obj_t *layers[4];
+    lv_display_t *disp;
+    obj_meta_t *meta;
+    int32_t i;
+
+    if (init_ui_object_ctx(ctx))
+        return -1;
+
+    ctx->objs.next_id = 1;
+    set_scr_size(DISP_WIDTH, DISP_HEIGHT);
+
+    lv_init();
+    disp = lv_display_create(DISP_WIDTH, DISP_HEIGHT);
+    if (!disp)
+        return -1;
+
+    lv_display_set_buffers(disp, draw_buf, NULL, sizeof(draw_buf), \
+                           LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(disp, flush_cb);
+
+    /* Same base components as ui_main_init() */
+    layers[0] = lv_layer_sys();
+    layers[1] = lv_layer_top();
+    layers[2] = lv_screen_active();
+    layers[3] = lv_layer_bottom();
+
+    for (i = 0; i < 4; i++) {
+        meta = register_obj(NULL, layers[i], NULL);
+        if (!meta)
+            return -1;
+        meta->theme.level = 0;
+    }
+
+    return 0;
+}
+
+static void account(teardown_result_t *res, uint32_t nr_objs, uint64_t ns)
+{
+    res->nr_objs = nr_objs;
+    res->total_ns += ns;
+    wq_hist_record(&res->hist, ns);
+}
+
+static int32_t run_once(ctx_t *ctx)
+{
+    lv_obj_t *base, *setting, *kb;
+    obj_footprint_t fp;
+    uint64_t start;
+    int32_t ret;
+
+    base = create_common_screen(ctx, lv_screen_active(), LAYOUT_SETTING);
+    if (!base)
+        return -1;
+
+    /* Keyboard first, remove_keyboard() refreshes the whole screen */
+    kb = create_keyboard(base);
+    if (!kb || get_obj_footprint(kb, &fp))
+        return -1;
+
+    start = now_ns();
+    ret = remove_obj_and_child(get_meta(kb)->id, &get_meta(base)->child);
+    account(&res_keyboard, fp.nr_objs, now_ns() - start);
+    if (ret)
+        return -1;
+
+    /* Only forgets the active layout, the keyboard is already gone */
+    remove_keyboard(ctx);
+
+    setting = get_obj_by_name(SETTING_BASED_NAME, &get_meta(base)->child);
+    if (!setting || get_obj_footprint(setting, &fp))
+        return -1;
+
+    start = now_ns();
+    ret = remove_obj_and_child(get_meta(setting)->id, &get_meta(base)->child);
+    account(&res_setting, fp.nr_objs, now_ns() - start);
+    if (ret)
+        return -1;
+
+    ctx->scr.now.obj = NULL;
+    return remove_obj_and_child(get_meta(base)->id, NULL);
+}
+
+static void print_result(const teardown_result_t *res, int32_t iterations)
+{
+    printf("%-10s %6u %10.1f %8u %8u %8u\n", res->name, res->nr_objs, \
+           (double)res->total_ns / iterations / 1000.0, \
+           wq_hist_percentile(&res->hist, 50), \
+           wq_hist_percentile(&res->hist, 99), \
+           atomic_load(&res->hist.max_us));
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+ctx_t *get_ctx()
+{
+    return &bench_ctx;
+}
+
+int main(int argc, char **argv)
+{
+    int32_t iterations = argc > 1 ? atoi(argv[1]) : DEF_ITERATIONS;
+    int32_t i;
+
+    if (iterations <= 0)
+        return 1;
+
+    if (bench_ui_init(&bench_ctx)) {
+        fprintf(stderr, "UI init failed\n");
+        return 1;
+    }
+
+    for (i = 0; i < iterations; i++) {
+        if (run_once(&bench_ctx)) {
+            fprintf(stderr, "Iteration %d failed\n", i);
+            return 1;
+        }
+    }
+
+    printf("%-10s %6s %10s %8s %8s %8s\n", "subtree", "objs", "avg us", \
+           "p50 us", "p99 us", "max us");
+    print_result(&res_keyboard, iterations);
+    print_result(&res_setting, iterations);
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file wq_bench.c
+ *
+ * Workqueue micro-benchmark: several producers push empty work items while
+ * the workers record the enqueue-to-dequeue latency of each one. Built once
+ * per run queue backend (wq-bench-mutex, wq-bench-lockless).
+ *
+ * Usage: wq-bench [producers] [items per producer] [workers] [interval us]
+ *
+ * With the default interval of 0 the producers saturate the queue and the
+ * run reports peak throughput. A non-zero interval paces every producer, so
+ * the latency figures show the cost of an uncontended hand-over instead of
+ * the backlog.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "util.h"
+#include "comm/cmd_payload.h"
+#include "sched/workqueue.h"
+#include "main.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEF_PRODUCERS                   3
+#define DEF_ITEMS                       100000
+#define DEF_WORKERS                     2
+#define DEF_INTERVAL_US                 0
+
+#if defined(WQ_LOCKLESS)
+#define BACKEND_NAME                    "lockless ring"
+#else
+#define BACKEND_NAME                    "mutex list"
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct {
+    int32_t nr_items;
+    uint64_t interval_ns;
+    uint64_t *stamps;
+} producer_arg_t;
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static ctx_t bench_ctx;
+static uint64_t *latency_ns;
+static uint64_t *stamps;
+static atomic_int nr_done;
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void *producer(void *arg)
+{
+    producer_arg_t *p = arg;
+    uint64_t next = now_ns();
+    local_cmd_t *cmd;
+    work_t *w;
+    int32_t i;
+
+    for (i = 0; i < p->nr_items; i++) {
+        if (p->interval_ns) {
+            next += p->interval_ns;
+            while (now_ns() < next)
+                ;
+        }
+
+        cmd = create_local_cmd();
+        if (!cmd)
+            break;
+
+        cmd->opcode = OP_PING;
+        cmd->payload = &p->stamps[i];
+        p->stamps[i] = now_ns();
+        w = create_work(WORK_TYPE_LOCAL, WORK_PRIO_NORMAL, \
+                        WORK_DURATION_SHORT, OP_PING, cmd);
+        if (!w) {
+            delete_local_cmd(cmd);
+            break;
+        }
+
+        push_work(get_wq(UI_WQ), w);
+    }
+
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double pct_us(const uint64_t *sorted, int32_t n, double pct)
+{
+    int32_t idx = (int32_t)((n - 1) * pct / 100.0);
+
+    return sorted[idx] / 1000.0;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+ctx_t *get_ctx()
+{
+    return &bench_ctx;
+}
+
+int32_t process_opcode(uint32_t opcode, void *data)
+{
+    uint64_t t = now_ns();
+    local_cmd_t *cmd = data;
+    int32_t idx;
+
+    idx = atomic_fetch_add(&nr_done, 1);
+    latency_ns[idx] = t - *(uint64_t *)cmd->payload;
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int32_t nr_prod = argc > 1 ? atoi(argv[1]) : DEF_PRODUCERS;
+    int32_t nr_items = argc > 2 ? atoi(argv[2]) : DEF_ITEMS;
+    int32_t nr_workers = argc > 3 ? atoi(argv[3]) : DEF_WORKERS;
+    int32_t interval_us = argc > 4 ? atoi(argv[4]) : DEF_INTERVAL_US;
+    producer_arg_t *parg;
+    pthread_t *prod;
+    wq_conf_t conf;
+    uint64_t start, elapsed;
+    int32_t i, total;
+
+    if (nr_prod <= 0 || nr_items <= 0 || nr_workers <= 0 || interval_us < 0)
+        return 1;
+
+    total = nr_prod * nr_items;
+    latency_ns = calloc(total, sizeof(*latency_ns));
+    stamps = calloc(total, sizeof(*stamps));
+    parg = calloc(nr_prod, sizeof(*parg));
+    prod = calloc(nr_prod, sizeof(*prod));
+    if (!latency_ns || !stamps || !parg || !prod)
+        return 1;
+
+    bench_ctx.run = 1;
+    conf.nr_queues = 1;
+    conf.nr_workers[WORK_DURATION_SHORT] = nr_workers;
+    conf.nr_workers[WORK_DURATION_LONG] = 0;
+    if (workqueue_init(&conf))
+        return 1;
+
+    start = now_ns();
+    for (i = 0; i < nr_prod; i++) {
+        parg[i].nr_items = nr_items;
+        parg[i].interval_ns = (uint64_t)interval_us * 1000;
+        parg[i].stamps = &stamps[i * nr_items];
+        pthread_create(&prod[i], NULL, producer, &parg[i]);
+    }
+    for (i = 0; i < nr_prod; i++)
+        pthread_join(prod[i], NULL);
+
+    while (atomic_load(&nr_done) < total)
+        sched_yield();
+    elapsed = now_ns() - start;
+
+    bench_ctx.run = 0;
+    workqueue_deinit();
+
+    qsort(latency_ns, total, sizeof(*latency_ns), cmp_u64);
+
+    printf("backend     : %s\n", BACKEND_NAME);
+    printf("producers   : %d x %d items every %d us, %d workers\n", \
+           nr_prod, nr_items, interval_us, nr_workers);
+    printf("throughput  : %.0f items/s\n", total / (elapsed / 1e9));
+    printf("latency (us): p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", \
+           pct_us(latency_ns, total, 50), pct_us(latency_ns, total, 90), \
+           pct_us(latency_ns, total, 99), latency_ns[total - 1] / 1000.0);
+
+    free(prod);
+    free(parg);
+    free(stamps);
+    free(latency_ns);
+    return 0;
+}
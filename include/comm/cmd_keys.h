@@ -0,0 +1,75 @@
+/**
+ * @file cmd_keys.h
+ *
+ */
+
+#ifndef G_CMD_KEYS_H
+#define G_CMD_KEYS_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+/*
+ * Payload keys known to both services: X(id, wire name). The enum and the
+ * name table are generated from this list, so a key is added in one place.
+ * Ids are sent instead of names in compact frames, append new keys at the
+ * end to keep the ids of existing ones.
+ *
+ * Keys that carry data themselves, like SSIDs in OP_WIFI_AP_LIST, are not
+ * registered and resolve to KEY_NONE.
+ */
+#define CMD_KEY_LIST(X)                                 \
+    X(KEY_NONE,                     "")                 \
+    X(KEY_ALS_ENABLE,               "als_enable")       \
+    X(KEY_BRIGHTNESS,               "brightness")       \
+    X(KEY_IMU_ENABLE,               "imu_enable")       \
+    X(KEY_IMU_ROLL,                 "roll")             \
+    X(KEY_IMU_PITCH,                "pitch")            \
+    X(KEY_IMU_YAW,                  "yaw")              \
+    X(KEY_WIFI_ENABLE,              "wifi_enable")
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+#define CMD_KEY_ENUM(id, name)          id,
+typedef enum {
+    CMD_KEY_LIST(CMD_KEY_ENUM)
+    NR_CMD_KEYS,
+} cmd_key_t;
+#undef CMD_KEY_ENUM
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  GLOBAL PROTOTYPES
+ **********************/
+const char *cmd_key_name(cmd_key_t key);
+cmd_key_t cmd_key_lookup(const char *name);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#endif /* G_CMD_KEYS_H */
@@ -10,12 +10,16 @@
  *********************/
 #include <stdint.h>
 
+#include "comm/cmd_keys.h"
+#include "mem/arena.h"
+#include "sched/workqueue.h"
+
 /*********************
  *      DEFINES
  *********************/
 #define COMP_NAME                       "TERMINAL-UI"
-#define COMP_ID                         01
-#define MAX_ENTRIES                     32
+#define REMOTE_CMD_INLINE_ENTRIES       4   /* Entries without arena */
+#define REMOTE_CMD_MAX_ENTRIES          4096
 
 /**********************
  *      TYPEDEFS
@@ -89,9 +93,18 @@ typedef struct {
     uint32_t data_type;       // DBus data type code (e.g., DBUS_TYPE_STRING)
     uint32_t data_length;     // Data length (used if type is array/string)
     variant_val_t value;      // Actual value
+    uint8_t key_id;           // Registered key, KEY_NONE for free-form keys
 } payload_t;
 
-// Top-level data frame structure
+struct DBusMessage;
+
+/*
+ * Top-level data frame structure
+ *
+ * A few entries are stored inline, larger payloads get an entry array sized
+ * to their count from the command arena, which also holds the strings
+ * copied by the remote_cmd_add_*() helpers.
+ */
 typedef struct {
     const char *component_id;    // Identifier of the sender
     uint32_t umid;                // Message ID
@@ -99,7 +112,12 @@ typedef struct {
     uint8_t prio;
     uint8_t duration;
     uint32_t entry_count;         // Number of entries in the payload
-    payload_t entries[MAX_ENTRIES]; // Payload entries
+    uint32_t entry_cap;           // Entries available in entries[]
+    payload_t *entries;           // inline_entries or arena memory
+    uint16_t key_slot[NR_CMD_KEYS]; // Entry index + 1 per key, 0 if absent
+    struct DBusMessage *msg;      // Received frame, owns the strings above
+    arena_t arena;                // Released with the command
+    payload_t inline_entries[REMOTE_CMD_INLINE_ENTRIES];
 } remote_cmd_t;
 
 
@@ -121,6 +139,7 @@ typedef struct {
 /**********************
  *  GLOBAL PROTOTYPES
  **********************/
+uint32_t remote_cmd_next_umid(void);
 remote_cmd_t *create_remote_cmd();
 void delete_remote_cmd(remote_cmd_t *cmd);
 
@@ -132,10 +151,27 @@ void remote_cmd_init(remote_cmd_t *cmd, const char *component_id, int32_t umid,
 int32_t remote_cmd_add_string(remote_cmd_t *cmd, const char *key, \
               const char *value);
 int32_t remote_cmd_add_int(remote_cmd_t *cmd, const char *key, int32_t value);
+int32_t remote_cmd_reserve(remote_cmd_t *cmd, uint32_t nr_entries);
+payload_t *remote_cmd_new_entry(remote_cmd_t *cmd);
+
+/* Keyed access, see cmd_keys.h */
+void remote_cmd_index_entry(remote_cmd_t *cmd, uint32_t idx);
+int32_t remote_cmd_add_i32(remote_cmd_t *cmd, cmd_key_t key, int32_t value);
+int32_t remote_cmd_add_str(remote_cmd_t *cmd, cmd_key_t key, \
+                           const char *value);
+int32_t remote_cmd_get_i32(const remote_cmd_t *cmd, cmd_key_t key, \
+                           int32_t *value);
+int32_t remote_cmd_get_i32_at(const remote_cmd_t *cmd, cmd_key_t key, \
+                              uint32_t pos, int32_t *value);
+int32_t remote_cmd_get_str(const remote_cmd_t *cmd, cmd_key_t key, \
+                           const char **value);
 
 /* Task helpper */
 int32_t create_local_simple_task(uint8_t priority, uint8_t duration, uint32_t opcode);
 int32_t create_remote_task(uint8_t priority, void *data);
+work_handle_t *create_remote_tracked_task(uint8_t priority, void *data);
+int32_t create_remote_delayed_task(uint8_t priority, void *data, \
+                                   uint32_t delay_ms);
 remote_cmd_t *create_remote_task_data(uint8_t priority, uint8_t duration, \
                                       uint32_t opcode);
 int32_t create_remote_simple_task(uint8_t priority, uint8_t duration, uint32_t opcode);
@@ -9,6 +9,7 @@
  *      INCLUDES
  *********************/
 #include <stdint.h>
+#include <stdbool.h>
 #include <dbus/dbus.h>
 
 #include "comm/cmd_payload.h"
@@ -60,8 +61,11 @@
 /**********************
  *  GLOBAL PROTOTYPES
  **********************/
+DBusConnection *get_dbus_connection();
+int32_t set_dbus_connection(DBusConnection *conn);
 int32_t add_dbus_match_rule(DBusConnection *conn, const char *rule);
 void *dbus_fn_thread_handler();
+bool dbus_peer_is_compact(void);
 
 int32_t dbus_method_call(const char *destination, const char *path, \
                          const char *iface, const char *method, \
@@ -0,0 +1,64 @@
+/**
+ * @file dbus_req.h
+ *
+ */
+
+#ifndef G_DBUS_REQ_H
+#define G_DBUS_REQ_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <dbus/dbus.h>
+
+#include "comm/cmd_payload.h"
+#include "sched/workqueue.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DBUS_REQ_TIMEOUT_MS             3000    /* Default reply timeout */
+#define DBUS_REQ_TICK_MS                50      /* Timeout resolution */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  GLOBAL PROTOTYPES
+ **********************/
+work_handle_t *dbus_request(uint8_t priority, remote_cmd_t *cmd, \
+                            uint32_t timeout_ms, work_done_cb_t cb, void *arg);
+bool dbus_req_send(DBusConnection *conn, DBusMessage *msg, uint32_t umid);
+bool dbus_req_reply(DBusMessage *reply);
+void dbus_req_abort(uint32_t umid, int32_t result);
+void dbus_req_abort_sent(int32_t result);
+void dbus_req_cancel_all(int32_t result);
+void dbus_req_dump_stats(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#endif /* G_DBUS_REQ_H */
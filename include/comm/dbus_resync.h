@@ -0,0 +1,56 @@
+/**
+ * @file dbus_resync.h
+ *
+ */
+
+#ifndef G_DBUS_RESYNC_H
+#define G_DBUS_RESYNC_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DBUS_RECONNECT_MIN_MS           100     /* First retry delay */
+#define DBUS_RECONNECT_MAX_MS           5000    /* Backoff ceiling */
+#define DBUS_RESYNC_RETRY_MS            1000    /* Before reissuing failures */
+#define DBUS_RESYNC_MAX_RETRIES         5
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  GLOBAL PROTOTYPES
+ **********************/
+void dbus_resync_link_lost(void);
+int32_t dbus_resync_start(void);
+void dbus_resync_dump_stats(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#endif /* G_DBUS_RESYNC_H */
@@ -0,0 +1,90 @@
+/**
+ * @file frame_codec.h
+ *
+ */
+
+#ifndef G_FRAME_CODEC_H
+#define G_FRAME_CODEC_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <dbus/dbus.h>
+
+#include "comm/cmd_payload.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*
+ * Compact frame: a single "ay" argument holding a fixed header, the
+ * component id, then every entry as a small header followed by its key and
+ * value bytes. Registered keys are sent as their id only, see cmd_keys.h.
+ * Strings keep their NUL so they can be used in place. Both ends share the
+ * bus of one machine, integers are in host byte order.
+ */
+#define FRAME_COMPACT_MAGIC             0x31524654  /* "TFR1" */
+#define FRAME_COMPACT_VERSION           1
+#define FRAME_COMPACT_SIG               "ay"
+#define FRAME_COMPACT_MAX               4096        /* Larger: legacy frame */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum {
+    FRAME_FMT_LEGACY = 0,               /* s i i i i a(siiv) */
+    FRAME_FMT_COMPACT,                  /* ay */
+} frame_fmt_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t prio;
+    uint8_t duration;
+    uint8_t reserved;
+    uint32_t umid;
+    uint32_t opcode;
+    uint16_t entry_count;
+    uint16_t comp_len;                  /* Including the NUL */
+} frame_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t data_type;                  /* DBus type code */
+    uint8_t key_id;                     /* KEY_NONE: the name follows */
+    uint8_t key_len;                    /* Including the NUL, 0 with an id */
+    uint8_t reserved;
+    uint16_t val_len;                   /* Including the NUL of strings */
+} frame_entry_hdr_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  GLOBAL PROTOTYPES
+ **********************/
+int32_t encode_data_frame(DBusMessage *msg, const remote_cmd_t *cmd, \
+                          frame_fmt_t fmt);
+int32_t decode_data_frame(DBusMessage *msg, remote_cmd_t *out);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#endif /* G_FRAME_CODEC_H */
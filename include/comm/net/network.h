@@ -15,10 +15,6 @@
  *********************/
 #define NM_SSID_MAX_LEN                 33  /* IEEE 802.11 */
 
-#ifndef MAX_ENTRIES
-#define MAX_ENTRIES                     32
-#endif
-#define WIFI_MAX_AP_CACHE               MAX_ENTRIES
 /**********************
  *      TYPEDEFS
  **********************/
@@ -34,10 +30,15 @@ typedef struct {
     uint32_t mode;
 } ap_info_t;
 
+/* Scan result, sized to the number of access points found */
+typedef struct {
+    int32_t count;
+    ap_info_t ap[];
+} ap_list_t;
+
 typedef struct {
     ap_info_t active_ap;
-    ap_info_t cached_ap[WIFI_MAX_AP_CACHE];
-    int8_t ap_count;
+    ap_list_t *cached;                  /* Owned by the UI thread */
 } wifi_info_t;
 
 /**********************
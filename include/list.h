@@ -130,6 +130,16 @@ static inline void list_del(struct list_head *entry)
     entry->prev = LIST_POISON2;
 }
 
+/**
+ * list_del_init - deletes entry from list and reinitialize it.
+ * @entry: the element to delete from the list.
+ */
+static inline void list_del_init(struct list_head *entry)
+{
+    __list_del_entry(entry);
+    INIT_LIST_HEAD(entry);
+}
+
 /**
  * list_is_head - tests whether @list is the list @head
  * @list: the entry to test
@@ -49,6 +49,7 @@ typedef struct ctx {
     scr_ctx_t scr;
     obj_ctx_t objs;
     wq_ctx_t *wqs;
+    int32_t nr_wqs;
     op_t op;
     comm_t comm;
     conf_t cfg;
@@ -67,6 +68,8 @@ typedef struct ctx {
  **********************/
 ctx_t *get_ctx();
 int32_t process_opcode(uint32_t opcode, void *data);
+int32_t task_handlers_init(void);
+void task_handlers_deinit(void);
 
 /**********************
  *  STATIC VARIABLES
@@ -0,0 +1,52 @@
+/**
+ * @file arena.h
+ *
+ */
+
+#ifndef G_ARENA_H
+#define G_ARENA_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define ARENA_CHUNK_MIN                 256 /* Bytes, first chunk included */
+#define ARENA_ALIGN                     sizeof(void *)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+struct arena_chunk;
+
+/*
+ * Bump allocator owned by a single object. Allocations are never freed one
+ * by one, every chunk goes back to the heap at once on arena_release().
+ * A zeroed arena is empty and ready to use.
+ */
+typedef struct arena {
+    struct arena_chunk *head;           /* Chunk being carved, then older */
+} arena_t;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+/*=====================
+ * Other functions
+ *====================*/
+void *arena_alloc(arena_t *arena, size_t size);
+char *arena_strdup(arena_t *arena, const char *str);
+void arena_release(arena_t *arena);
+
+#endif /* G_ARENA_H */
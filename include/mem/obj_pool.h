@@ -0,0 +1,86 @@
+/**
+ * @file obj_pool.h
+ *
+ */
+
+#ifndef G_OBJ_POOL_H
+#define G_OBJ_POOL_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define OBJ_POOL_MAX                    16  /* Pools with a thread cache */
+#define OBJ_POOL_CACHE_SIZE             16  /* Objects cached per thread */
+#define OBJ_POOL_SLAB_OBJS              32  /* Objects carved per slab */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+struct obj_slab;
+
+/*
+ * Fixed-size object pool. Objects are carved from slabs that are never
+ * returned to the heap, freed objects go back to a per-thread cache first
+ * and only move to the shared free list in batches.
+ */
+typedef struct obj_pool {
+    const char *name;
+    size_t obj_size;
+    atomic_int id;                      /* Registry slot, -1 until first use */
+    pthread_mutex_t lock;               /* Protects free_list and slabs */
+    void *free_list;
+    struct obj_slab *slabs;
+    atomic_uint nr_slabs;
+    atomic_uint nr_objs;                /* Capacity of all slabs */
+    atomic_uint in_use;                 /* Handed out to callers */
+    atomic_uint high_water;             /* Peak of in_use */
+} obj_pool_t;
+
+typedef struct obj_pool_stats {
+    const char *name;
+    size_t obj_size;
+    uint32_t nr_slabs;
+    uint32_t nr_objs;
+    uint32_t in_use;
+    uint32_t high_water;
+} obj_pool_stats_t;
+
+/**********************
+ *      MACROS
+ **********************/
+#define OBJ_POOL_INITIALIZER(_name, _type) {                        \
+    .name = (_name),                                                \
+    .obj_size = sizeof(_type) > sizeof(void *) ?                    \
+                sizeof(_type) : sizeof(void *),                     \
+    .id = -1,                                                       \
+    .lock = PTHREAD_MUTEX_INITIALIZER,                              \
+}
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+/*=====================
+ * Getter functions
+ *====================*/
+void obj_pool_get_stats(obj_pool_t *pool, obj_pool_stats_t *stats);
+
+/*=====================
+ * Other functions
+ *====================*/
+void *obj_pool_alloc(obj_pool_t *pool);
+void *obj_pool_zalloc(obj_pool_t *pool);
+void obj_pool_free(obj_pool_t *pool, void *obj);
+void obj_pool_dump_stats(void);
+
+#endif /* G_OBJ_POOL_H */
@@ -0,0 +1,52 @@
+/**
+ * @file str_intern.h
+ *
+ */
+
+#ifndef G_STR_INTERN_H
+#define G_STR_INTERN_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define STR_INTERN_MIN_SLOTS            128 /* Power of two */
+#define STR_INTERN_IDLE_MAX             256 /* Unused strings kept for reuse */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct str_intern_stats {
+    uint32_t nr_strs;                   /* Including the idle ones */
+    uint32_t nr_idle;                   /* No reference left */
+    size_t bytes;                       /* Heap used by the strings */
+} str_intern_stats_t;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+/*=====================
+ * Getter functions
+ *====================*/
+void str_intern_get_stats(str_intern_stats_t *stats);
+
+/*=====================
+ * Other functions
+ *====================*/
+const char *str_intern(const char *str);
+void str_intern_put(const char *str);
+void str_intern_dump_stats(void);
+
+#endif /* G_STR_INTERN_H */
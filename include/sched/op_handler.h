@@ -0,0 +1,81 @@
+/**
+ * @file op_handler.h
+ *
+ */
+
+#ifndef G_OP_HANDLER_H
+#define G_OP_HANDLER_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "list.h"
+#include "comm/cmd_payload.h"
+#include "sched/workqueue.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define OP_PRIO_FRAME                   -1  /* Keep the priority of the frame */
+#define OP_DROP_DEPTH                   64  /* Queued works before dropping */
+
+/* Handler flags */
+#define OP_F_UI_THREAD                  (1U << 0) /* Run by the UI thread */
+#define OP_F_DROPPABLE                  (1U << 1) /* Dropped under load */
+#define OP_F_COALESCE                   (1U << 2) /* Newest report wins */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef int32_t (*op_fn_t)(void *data);
+
+/*
+ * Handler of one opcode and where its works run. The route is looked up
+ * once, when an incoming frame is decoded. Handlers are registered at
+ * startup, before the DBus listener runs, and stay for the whole run.
+ */
+typedef struct op_entry {
+    struct list_head node;              /* In ctx->op.handler_lst */
+    uint32_t opcode;
+    op_fn_t fn;
+    int32_t wq;                         /* Workqueue index, e.g. UI_WQ */
+    int8_t prio;                        /* Work priority or OP_PRIO_FRAME */
+    uint32_t flags;                     /* OP_F_* */
+} op_entry_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  GLOBAL PROTOTYPES
+ **********************/
+int32_t op_register(op_entry_t *ent);
+void op_unregister_all(void);
+const op_entry_t *op_lookup(uint32_t opcode);
+int32_t op_run(uint32_t opcode, void *data);
+int32_t op_post_ui(remote_cmd_t *cmd);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#endif /* G_OP_HANDLER_H */
@@ -0,0 +1,72 @@
+/**
+ * @file ring.h
+ *
+ */
+
+#ifndef G_RING_H
+#define G_RING_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define RING_CACHELINE                  64
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+/*
+ * Bounded multi-producer/multi-consumer ring of fixed size elements.
+ * Every cell carries a sequence number telling whether it is free for the
+ * producer of lap N or filled for the consumer of lap N, so push and pop
+ * only contend on a single compare-and-swap of their own index.
+ */
+typedef struct ring {
+    _Alignas(RING_CACHELINE) atomic_size_t head;    /* Next slot to pop */
+    _Alignas(RING_CACHELINE) atomic_size_t tail;    /* Next slot to push */
+    _Alignas(RING_CACHELINE) size_t mask;
+    size_t elem_size;
+    size_t stride;
+    uint8_t *cells;
+} ring_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+/*=====================
+ * Setter functions
+ *====================*/
+
+/*=====================
+ * Getter functions
+ *====================*/
+size_t ring_count(ring_t *r);
+int32_t ring_peek_stamp(ring_t *r, uint64_t *stamp);
+
+/*=====================
+ * Other functions
+ *====================*/
+ring_t *ring_create(uint32_t nr_slots, uint32_t elem_size);
+void ring_destroy(ring_t *r);
+int32_t ring_push_stamp(ring_t *r, const void *elem, uint64_t stamp);
+int32_t ring_pop(ring_t *r, void *elem);
+
+static inline int32_t ring_push(ring_t *r, const void *elem)
+{
+    return ring_push_stamp(r, elem, 0);
+}
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /* G_RING_H */
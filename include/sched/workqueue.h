@@ -9,21 +9,60 @@
  *      INCLUDES
  *********************/
 #include <stdint.h>
+#include <stdbool.h>
 #include <pthread.h>
 #include <stdatomic.h>
 
 #include "list.h"
+#if defined(WQ_LOCKLESS)
+#include "sched/ring.h"
+#endif
 
 /*********************
  *      DEFINES
  *********************/
 /*
- * Depends on application to modify these values
+ * Default sizing, used when the application does not provide a
+ * configuration. Each value can be overridden at runtime through the
+ * environment variables below, see workqueue_default_conf().
  */
-#define NR_WORKQUEUE                    1
-#define WORKERS_PER_QUEUE               2
+#define WQ_DEFAULT_NR_QUEUES            1
+#define WQ_DEFAULT_SHORT_WORKERS        2
+#define WQ_DEFAULT_LONG_WORKERS         1
+#define WQ_MAX_QUEUES                   8
+#define WQ_MAX_WORKERS                  16
+
+#define WQ_ENV_NR_QUEUES                "TERMINAL_UI_WQ_QUEUES"
+#define WQ_ENV_SHORT_WORKERS            "TERMINAL_UI_WQ_SHORT_WORKERS"
+#define WQ_ENV_LONG_WORKERS             "TERMINAL_UI_WQ_LONG_WORKERS"
 
 #define UI_WQ                           0
+
+/*
+ * Scheduling of the per-priority run queues. In strict mode, a waiting
+ * work item gains one priority level for every WQ_AGING_STEP_MS it stays
+ * queued, so LOW work is eventually served even under a constant stream of
+ * higher priority work.
+ */
+#define WQ_DEFAULT_POLICY               WQ_POLICY_STRICT
+#define WQ_AGING_STEP_MS                100
+
+/* Weighted mode: number of items served per round for each priority */
+#define WQ_WEIGHT_LOW                   1
+#define WQ_WEIGHT_NORMAL                2
+#define WQ_WEIGHT_HIGH                  4
+#define WQ_WEIGHT_URGENT                8
+
+/*
+ * With WQ_LOCKLESS, each run queue is a bounded lock-free ring. Pushes that
+ * find the ring full spill into the mutex protected list, which is drained
+ * before the ring accepts new items again.
+ */
+#define WQ_RING_SLOTS                   256
+
+/* Delayed and periodic work timers pending at the same time */
+#define WQ_TIMER_MAX                    32
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -37,13 +76,46 @@ typedef enum {
     WORK_PRIO_NORMAL,
     WORK_PRIO_HIGH,
     WORK_PRIO_URGENT,
+    NR_WORK_PRIO,
 } work_priority_t;
 
+typedef enum {
+    WQ_POLICY_STRICT = 0,               /* Highest priority first, aged */
+    WQ_POLICY_WEIGHTED,                 /* Weighted round robin by priority */
+} wq_policy_t;
+
 typedef enum {
     WORK_DURATION_SHORT = 0,
     WORK_DURATION_LONG,
+    NR_WORK_DURATION,
 } work_duration_t;
 
+typedef enum {
+    WORK_STATE_PENDING = 0,
+    WORK_STATE_RUNNING,
+    WORK_STATE_DONE,
+    WORK_STATE_CANCELED,
+} work_state_t;
+
+/* Called once per tracked work with the handler result or -ECANCELED */
+typedef void (*work_done_cb_t)(int32_t result, void *arg);
+
+/*
+ * Completion handle of a tracked work. One reference belongs to the work,
+ * one to the caller of push_work_tracked(), the last put frees it. A handle
+ * from work_handle_create() is completed by its producer instead, e.g. when
+ * a remote reply arrives.
+ */
+typedef struct work_handle {
+    atomic_int refs;
+    atomic_int state;                   /* work_state_t */
+    int32_t result;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;                /* Signaled on DONE or CANCELED */
+    work_done_cb_t done_cb;
+    void *done_arg;
+} work_handle_t;
+
 typedef struct work {
     struct list_head node;
     work_type_t type;
@@ -51,19 +123,58 @@ typedef struct work {
     work_duration_t duration;
     uint32_t opcode;
     void *data;
+    uint64_t enqueue_ns;                /* CLOCK_MONOTONIC time of push */
+    uint64_t start_ns;                  /* Handler started */
+    uint64_t end_ns;                    /* Handler returned */
+    struct list_head pend_node;         /* Linked while coalescable, queued */
+    uint32_t coalesce_key;
+    work_handle_t *handle;              /* NULL unless pushed tracked */
 } work_t;
 
-typedef struct workqueue {
-    struct list_head list;
+struct workqueue;
+
+/*
+ * Worker pool of a workqueue. Short and long work are queued and served by
+ * separate pools, so a blocking item can only hold up other long work.
+ */
+typedef struct wq_pool {
+    struct workqueue *wq;               /* Owner workqueue */
+    work_duration_t duration;           /* Work class served by this pool */
+    struct list_head runq[NR_WORK_PRIO];
+    atomic_int credit[NR_WORK_PRIO];    /* Weighted mode: remaining quota */
+    wq_policy_t policy;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
+#if defined(WQ_LOCKLESS)
+    ring_t *ring[NR_WORK_PRIO];
+    atomic_int spilled[NR_WORK_PRIO];   /* Items parked in runq */
+    atomic_uint wake_seq;               /* futex word for idle workers */
+    atomic_int nr_sleepers;
+#endif
+    pthread_t *workers;
+    int32_t nr_workers;  /* number of successfully created workers */
+} wq_pool_t;
+
+typedef struct workqueue {
+    wq_pool_t pool[NR_WORK_DURATION];
+    pthread_mutex_t mutex;              /* Protects drain waiters */
+    pthread_cond_t cond;                /* Signaled when fully drained */
     atomic_int active_cnt;
+    atomic_int peak_cnt;                /* Highest active_cnt seen */
+    pthread_mutex_t pend_lock;          /* Protects pending and their data */
+    struct list_head pending;           /* Queued coalescable work */
 } workqueue_t;
 
+/* Builds the work queued by a periodic timer, NULL skips the period */
+typedef work_t *(*work_factory_t)(void *arg);
+
+typedef struct wq_conf {
+    int32_t nr_queues;
+    int32_t nr_workers[NR_WORK_DURATION];
+} wq_conf_t;
+
 typedef struct wq_ctx {
     workqueue_t *wq;
-    pthread_t workers[WORKERS_PER_QUEUE];
-    int32_t nr_workers;  /* number of successfully created workers */
 } wq_ctx_t;
 
 /**********************
@@ -98,19 +209,44 @@ typedef struct wq_ctx {
  **********************/
 work_t *create_work(uint8_t type, uint8_t priority, uint8_t duration, \
                     uint32_t opcode, void *data);
+void delete_work(work_t *w);
 void workqueue_complete_work(workqueue_t *wq, work_t *w);
 void push_work(workqueue_t *wq, work_t *w);
-work_t *pop_work_wait_safe(workqueue_t *wq);
+void push_work_batch(workqueue_t *wq, work_t **works, int32_t nr);
+int32_t push_work_coalesce(workqueue_t *wq, work_t *w, uint32_t key);
+int32_t replace_pending_work(workqueue_t *wq, work_t *w, uint32_t key);
+int32_t queue_delayed_work(workqueue_t *wq, work_t *w, uint32_t delay_ms);
+int32_t queue_periodic_work(workqueue_t *wq, work_factory_t factory, \
+                            void *arg, uint32_t period_ms);
+int32_t cancel_timed_work(int32_t id);
+
+work_handle_t *push_work_tracked(workqueue_t *wq, work_t *w, \
+                                 work_done_cb_t cb, void *arg);
+int32_t work_cancel(work_handle_t *h);
+int32_t work_wait(work_handle_t *h, int32_t timeout_ms, int32_t *result);
+void work_handle_put(work_handle_t *h);
+work_handle_t *work_handle_create(work_done_cb_t cb, void *arg);
+bool work_handle_complete(work_handle_t *h, int32_t result);
+bool work_begin(work_t *w);
+void work_end(work_t *w, int32_t result);
+work_t *pop_work_wait_safe(wq_pool_t *pool);
 void workqueue_handler_wakeup(workqueue_t *wq);
 int32_t workqueue_handler_wakeup_all(void);
 int32_t workqueue_active_count(workqueue_t *wq);
+int32_t workqueue_drain(workqueue_t *wq, int32_t timeout_ms);
+int32_t workqueue_set_policy(workqueue_t *wq, wq_policy_t policy);
 
 void *workqueue_handler(void* arg);
 
 workqueue_t *get_wq(int32_t index);
+int32_t get_nr_wq(void);
 
-int32_t workqueue_init();
+void workqueue_default_conf(wq_conf_t *conf);
+int32_t workqueue_init(const wq_conf_t *conf);
 void workqueue_deinit();
+
+int32_t wq_timer_init(void);
+void wq_timer_deinit(void);
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -0,0 +1,73 @@
+/**
+ * @file wq_stats.h
+ *
+ */
+
+#ifndef G_WQ_STATS_H
+#define G_WQ_STATS_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "sched/workqueue.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*
+ * Log-linear histogram of microsecond values: every power of two range is
+ * split into 2^WQ_HIST_SUB_BITS linear buckets, so a recorded value is off
+ * by at most 1/2^WQ_HIST_SUB_BITS (12.5%). Values from 2^WQ_HIST_MAX_MSB us
+ * (about 67 s) up land in the last bucket.
+ */
+#define WQ_HIST_SUB_BITS                3
+#define WQ_HIST_SUB                     (1 << WQ_HIST_SUB_BITS)
+#define WQ_HIST_MAX_MSB                 26
+#define WQ_HIST_BUCKETS                 \
+    (WQ_HIST_SUB * (WQ_HIST_MAX_MSB - WQ_HIST_SUB_BITS + 2))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct wq_hist {
+    atomic_uint bucket[WQ_HIST_BUCKETS];
+    atomic_uint count;
+    atomic_ullong sum_us;
+    atomic_uint max_us;
+} wq_hist_t;
+
+typedef enum {
+    WQ_HIST_WAIT = 0,                   /* Push to start of the handler */
+    WQ_HIST_SERVICE,                    /* Handler run time */
+    NR_WQ_HIST,
+} wq_hist_type_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+/*=====================
+ * Getter functions
+ *====================*/
+uint32_t wq_hist_percentile(const wq_hist_t *h, double pct);
+const wq_hist_t *wq_stats_hist(uint32_t opcode, wq_hist_type_t type);
+
+/*=====================
+ * Other functions
+ *====================*/
+void wq_hist_record(wq_hist_t *h, uint64_t ns);
+void wq_stats_work_start(work_t *w);
+void wq_stats_work_done(work_t *w);
+void wq_stats_reset(void);
+void wq_stats_dump(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /* G_WQ_STATS_H */
@@ -0,0 +1,44 @@
+/**
+ * @file obj_geom.h
+ *
+ */
+
+#ifndef G_OBJ_GEOM_H
+#define G_OBJ_GEOM_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+#include "ui/ui_core.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define OBJ_GEOM_MIN_SLOTS              64
+
+/* Side table bytes held by one object */
+#define OBJ_GEOM_SLOT_BYTES             \
+    (sizeof(obj_size_t) + sizeof(obj_align_t) + sizeof(obj_pad_t) + \
+     sizeof(int8_t) + sizeof(uint8_t) + sizeof(obj_meta_t *))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+int32_t obj_geom_alloc(obj_meta_t *meta);
+void obj_geom_free(obj_meta_t *meta);
+void obj_geom_reset(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /* G_OBJ_GEOM_H */
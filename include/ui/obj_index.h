@@ -0,0 +1,41 @@
+/**
+ * @file obj_index.h
+ *
+ */
+
+#ifndef G_OBJ_INDEX_H
+#define G_OBJ_INDEX_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+#include "ui/ui_core.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define OBJ_INDEX_MIN_SLOTS             64  /* Power of two */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+int32_t obj_index_add(obj_meta_t *meta);
+void obj_index_del(obj_meta_t *meta);
+obj_meta_t *obj_index_find_id(uint32_t id);
+obj_meta_t *obj_index_find_name(const char *name);
+void obj_index_reset(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /* G_OBJ_INDEX_H */
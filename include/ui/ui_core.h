@@ -29,6 +29,14 @@
 #define ENA_SCALE                       1
 
 #define bg_color(x)                     color_gray_levels_inv[x]
+
+/* Why refresh_object_tree_layout() must transform an object again */
+#define OBJ_DIRTY_GEOMETRY              (1U << 0) /* Size, alignment, position */
+#define OBJ_DIRTY_ROTATION              (1U << 1) /* Behind the screen rotation */
+#define OBJ_DIRTY_PADDING               (1U << 2) /* Padding, border side */
+#define OBJ_DIRTY_LAYOUT                (1U << 3) /* Grid or flex config */
+#define OBJ_DIRTY_SELF                  0x0FU
+#define OBJ_DIRTY_CHILD                 (1U << 7) /* Some descendant is dirty */
 /**********************
  *      TYPEDEFS
  **********************/
@@ -54,7 +62,6 @@ struct obj_meta_t;
 typedef struct {
     type_t obj_type;                    /* Main object type */
     void *internal;                     /* Internal data */
-    int8_t rotation;
     struct obj_meta_t *par_meta;
     /*
      * For some objects like the keyboard, the size and ratio are different
@@ -98,13 +105,16 @@ typedef struct {
     type_t cell_type;                   /* Layout cell type */
     void *cell_data;
     lv_border_side_t border_side;
+} obj_layout_t;
+
+typedef struct {
     int32_t pad_top;
     int32_t pad_bot;
     int32_t pad_left;
     int32_t pad_right;
     int32_t pad_row;
     int32_t pad_column;
-} obj_layout_t;
+} obj_pad_t;
 
 typedef struct {
     int32_t level;
@@ -117,17 +127,44 @@ typedef struct obj_meta_t {
     struct list_head child;
     uint32_t id;
     lv_obj_t *obj;
-    char *name;
-    obj_size_t size;
-    obj_align_t align;
+    const char *name;                   /* Interned, see str_intern.h */
+    struct list_head name_node;         /* Same name objects, see obj_index.c */
+    uint32_t geom;                      /* Geometry slot, see obj_geom.c */
     obj_layout_t layout;
     obj_data_t data;
     obj_theme_t theme;
 } obj_meta_t;
 
+/* Memory held by the metadata of an object subtree */
+typedef struct obj_footprint {
+    uint32_t nr_objs;
+    uint32_t nr_named;
+    size_t meta_bytes;                  /* Geometry slots included */
+    size_t name_bytes;                  /* Interned, may be shared */
+} obj_footprint_t;
+
+/*
+ * Geometry read and written by the rotation and refresh passes, kept out of
+ * obj_meta_t as one array per field group. Slots follow registration order,
+ * so a subtree built in one go sits in consecutive slots.
+ */
+typedef struct obj_geom {
+    obj_size_t *size;
+    obj_align_t *align;
+    obj_pad_t *pad;
+    int8_t *rotation;
+    uint8_t *dirty;                     /* OBJ_DIRTY_* */
+    obj_meta_t **owner;                 /* NULL for a free slot */
+    uint32_t nr_slots;                  /* Allocated */
+    uint32_t nr_used;                   /* Slots below, free ones included */
+    uint32_t nr_free;
+} obj_geom_t;
+
 /**********************
  *  GLOBAL VARIABLES
  **********************/
+/* Only touched by the UI thread, like the object tree itself */
+extern obj_geom_t obj_geom;
 
 /**********************
  * GLOBAL PROTOTYPES
@@ -168,6 +205,10 @@ int32_t set_column_padding(lv_obj_t *lobj, int32_t pad);
 
 void set_internal_data(lv_obj_t *lobj, void *data);
 
+void mark_meta_dirty(obj_meta_t *meta, uint8_t flags);
+void mark_obj_dirty(lv_obj_t *lobj, uint8_t flags);
+void mark_all_dirty(uint8_t flags);
+
 /*=====================
  * Getter functions
  *====================*/
@@ -188,6 +229,7 @@ int32_t remove_obj_and_child_by_name(const char *name, \
                                         struct list_head *head_lst);
 int32_t remove_obj_and_child(uint32_t req_id, struct list_head *head_lst);
 int32_t remove_children(lv_obj_t *par);
+int32_t get_obj_footprint(lv_obj_t *lobj, obj_footprint_t *fp);
 int32_t init_ui_object_ctx(ctx_t *ctx);
 void destroy_ui_object_ctx(ctx_t *ctx);
 
@@ -226,6 +268,43 @@ static inline lv_obj_t *get_lobj(obj_meta_t *meta)
     return meta ? (lv_obj_t *)meta->obj : NULL;
 }
 
+static inline obj_size_t *get_meta_size(obj_meta_t *meta)
+{
+    return &obj_geom.size[meta->geom];
+}
+
+static inline obj_align_t *get_meta_align(obj_meta_t *meta)
+{
+    return &obj_geom.align[meta->geom];
+}
+
+static inline obj_pad_t *get_meta_pad(obj_meta_t *meta)
+{
+    return &obj_geom.pad[meta->geom];
+}
+
+static inline int8_t get_meta_rotation(obj_meta_t *meta)
+{
+    return obj_geom.rotation[meta->geom];
+}
+
+static inline void set_meta_rotation(obj_meta_t *meta, int8_t rot)
+{
+    obj_geom.rotation[meta->geom] = rot;
+    if (rot != get_scr_rotation())
+        mark_meta_dirty(meta, OBJ_DIRTY_ROTATION);
+}
+
+static inline uint8_t get_meta_dirty(obj_meta_t *meta)
+{
+    return obj_geom.dirty[meta->geom];
+}
+
+static inline void clear_meta_dirty(obj_meta_t *meta, uint8_t flags)
+{
+    obj_geom.dirty[meta->geom] &= ~flags;
+}
+
 static inline obj_meta_t *get_par_meta(lv_obj_t *lobj)
 {
     obj_meta_t *meta = lobj ? get_meta(lobj) : NULL;
@@ -234,22 +313,22 @@ static inline obj_meta_t *get_par_meta(lv_obj_t *lobj)
 
 static inline int32_t get_h(lv_obj_t *lobj)
 {
-    return (int32_t)get_meta(lobj)->size.h;
+    return (int32_t)get_meta_size(get_meta(lobj))->h;
 }
 
 static inline int32_t get_w(lv_obj_t *lobj)
 {
-    return (int32_t)get_meta(lobj)->size.w;
+    return (int32_t)get_meta_size(get_meta(lobj))->w;
 }
 
 static inline int32_t get_par_w(lv_obj_t *lobj)
 {
-    return lobj ? (int32_t)get_par_meta(lobj)->size.w : 0;
+    return lobj ? (int32_t)get_meta_size(get_par_meta(lobj))->w : 0;
 }
 
 static inline int32_t get_par_h(lv_obj_t *lobj)
 {
-    return lobj ? (int32_t)get_par_meta(lobj)->size.h : 0;
+    return lobj ? (int32_t)get_meta_size(get_par_meta(lobj))->h : 0;
 }
 
 static inline int32_t avail_px(int32_t par_size, int32_t percent)
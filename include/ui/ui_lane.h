@@ -0,0 +1,45 @@
+/**
+ * @file ui_lane.h
+ *
+ */
+
+#ifndef G_UI_LANE_H
+#define G_UI_LANE_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define UI_LANE_SLOTS                   256
+#define UI_LANE_RETRY_US                1000    /* Producer backoff when full */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+/* Same prototype as lv_async_cb_t, existing async callbacks fit as is */
+typedef void (*ui_cb_t)(void *arg);
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+/*=====================
+ * Other functions
+ *====================*/
+int32_t ui_lane_init(void);
+void ui_lane_deinit(void);
+int32_t ui_post(ui_cb_t cb, void *arg);
+int32_t ui_try_post(ui_cb_t cb, void *arg);
+int32_t ui_lane_drain(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /* G_UI_LANE_H */
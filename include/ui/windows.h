@@ -14,6 +14,7 @@
 #include "ui/ui_core.h"
 #include "ui/screen.h"
 #include "ui/widget/menu.h"
+#include "comm/cmd_payload.h"
 
 /*********************
  *      DEFINES
@@ -60,6 +61,12 @@ lv_obj_t *create_hotspot_setting(lv_obj_t *par, const char *name, \
 lv_obj_t *create_rotation_setting(lv_obj_t *par, const char *name, \
                                   view_ctn_t *par_v_ctx);
 
+/* Remote state reports, see task_exec.c */
+int32_t handle_backlight_state(remote_cmd_t *cmd);
+int32_t handle_wifi_state(remote_cmd_t *cmd);
+int32_t handle_wifi_access_point(remote_cmd_t *cmd);
+int32_t handle_imu_rotation_state(remote_cmd_t *cmd);
+
 /**********************
  *      MACROS
  **********************/
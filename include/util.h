@@ -0,0 +1,49 @@
+/**
+ * @file util.h
+ *
+ */
+
+#ifndef G_UTIL_H
+#define G_UTIL_H
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <time.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define NSEC_PER_USEC                   1000ULL
+#define NSEC_PER_MSEC                   1000000ULL
+#define NSEC_PER_SEC                    1000000000ULL
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+/* Monotonic time in nanoseconds, every deadline and latency is based on it */
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/**********************
+ *      MACROS
+ **********************/
+#define ARRAY_SIZE(a)                   ((int32_t)(sizeof(a) / sizeof((a)[0])))
+
+/* Parameters a callback signature imposes, or only read by log macros */
+#define __maybe_unused                  __attribute__((unused))
+
+#endif /* G_UTIL_H */
@@ -0,0 +1,286 @@
+/**
+ * @file cmd_keys.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <dbus/dbus.h>
+
+#include "comm/cmd_keys.h"
+#include "comm/cmd_payload.h"
+#include "comm/dbus_comm.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define KEY_HASH_SIZE                   64  /* Power of two, > NR_CMD_KEYS */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+#define CMD_KEY_NAME(id, name)          [id] = name,
+static const char *key_names[NR_CMD_KEYS] = {
+    CMD_KEY_LIST(CMD_KEY_NAME)
+};
+#undef CMD_KEY_NAME
+
+/* Open addressing on the name hash, 0 marks an empty bucket */
+static uint8_t key_hash[KEY_HASH_SIZE];
+static pthread_once_t key_hash_once = PTHREAD_ONCE_INIT;
+
+/**********************
+ *      MACROS
+ **********************/
+_Static_assert(NR_CMD_KEYS < KEY_HASH_SIZE, "Key hash table too small");
+_Static_assert(REMOTE_CMD_MAX_ENTRIES < UINT16_MAX, \
+               "Key slots hold entry indexes");
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static uint32_t key_name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+
+    while (*name)
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+
+    return h;
+}
+
+static void key_hash_build(void)
+{
+    uint32_t pos;
+    int32_t key;
+
+    for (key = KEY_NONE + 1; key < NR_CMD_KEYS; key++) {
+        pos = key_name_hash(key_names[key]);
+        while (key_hash[pos & (KEY_HASH_SIZE - 1)])
+            pos++;
+        key_hash[pos & (KEY_HASH_SIZE - 1)] = key;
+    }
+}
+
+static const payload_t *find_entry(const remote_cmd_t *cmd, cmd_key_t key)
+{
+    uint16_t slot;
+
+    if (!cmd || key <= KEY_NONE || key >= NR_CMD_KEYS)
+        return NULL;
+
+    slot = cmd->key_slot[key];
+    return slot ? &cmd->entries[slot - 1] : NULL;
+}
+
+static payload_t *add_entry(remote_cmd_t *cmd, cmd_key_t key, \
+                            uint32_t data_type)
+{
+    payload_t *entry;
+
+    if (!cmd || key <= KEY_NONE || key >= NR_CMD_KEYS)
+        return NULL;
+
+    entry = remote_cmd_new_entry(cmd);
+    if (!entry)
+        return NULL;
+
+    entry->key = key_names[key];
+    entry->key_id = key;
+    entry->data_type = data_type;
+    remote_cmd_index_entry(cmd, cmd->entry_count - 1);
+
+    return entry;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+const char *cmd_key_name(cmd_key_t key)
+{
+    if (key < KEY_NONE || key >= NR_CMD_KEYS)
+        return NULL;
+
+    return key_names[key];
+}
+
+/*
+ * cmd_key_lookup - Registered key of wire name @name
+ *
+ * Return: the key, or KEY_NONE for a free-form key.
+ */
+cmd_key_t cmd_key_lookup(const char *name)
+{
+    uint32_t pos;
+    uint8_t key;
+
+    if (!name || !*name)
+        return KEY_NONE;
+
+    pthread_once(&key_hash_once, key_hash_build);
+
+    pos = key_name_hash(name);
+    while ((key = key_hash[pos & (KEY_HASH_SIZE - 1)])) {
+        if (!strcmp(key_names[key], name))
+            return key;
+        pos++;
+    }
+
+    return KEY_NONE;
+}
+
+/*
+ * remote_cmd_index_entry - Make entry @idx of @cmd reachable by its key
+ *
+ * The key id is resolved from the key name unless already set. When a key
+ * appears twice, the first entry wins.
+ */
+void remote_cmd_index_entry(remote_cmd_t *cmd, uint32_t idx)
+{
+    payload_t *entry = &cmd->entries[idx];
+
+    if (entry->key_id == KEY_NONE)
+        entry->key_id = cmd_key_lookup(entry->key);
+
+    if (entry->key_id != KEY_NONE && !cmd->key_slot[entry->key_id])
+        cmd->key_slot[entry->key_id] = idx + 1;
+}
+
+int32_t remote_cmd_add_i32(remote_cmd_t *cmd, cmd_key_t key, int32_t value)
+{
+    payload_t *entry;
+
+    entry = add_entry(cmd, key, DBUS_TYPE_INT32);
+    if (!entry)
+        return -EINVAL;
+
+    entry->data_length = sizeof(int32_t);
+    entry->value.i32 = value;
+    return 0;
+}
+
+/* @value is copied into the command */
+int32_t remote_cmd_add_str(remote_cmd_t *cmd, cmd_key_t key, \
+                           const char *value)
+{
+    payload_t *entry;
+    char *dup;
+
+    if (!cmd || !value)
+        return -EINVAL;
+
+    dup = arena_strdup(&cmd->arena, value);
+    if (!dup)
+        return -ENOMEM;
+
+    entry = add_entry(cmd, key, DBUS_TYPE_STRING);
+    if (!entry)
+        return -EINVAL;
+
+    entry->data_length = strlen(dup) + 1;
+    entry->value.str = dup;
+    return 0;
+}
+
+/*
+ * remote_cmd_get_i32 - Integer value of @key in @cmd
+ *
+ * Return: 0 on success, -ENOENT if @cmd has no such entry, -EPROTO if the
+ * entry is not an integer.
+ */
+int32_t remote_cmd_get_i32(const remote_cmd_t *cmd, cmd_key_t key, \
+                           int32_t *value)
+{
+    const payload_t *entry;
+
+    entry = find_entry(cmd, key);
+    if (!entry)
+        return -ENOENT;
+
+    if (entry->data_type != DBUS_TYPE_INT32 && \
+        entry->data_type != DBUS_TYPE_UINT32) {
+        LOG_WARN("Key [%s] is not an integer", key_names[key]);
+        return -EPROTO;
+    }
+
+    *value = entry->value.i32;
+    return 0;
+}
+
+/*
+ * remote_cmd_get_i32_at - Integer value of @key, or of entry @pos
+ *
+ * Peers that predate the key registry send state frames with fixed entry
+ * positions and their own key names. Until the peer has shown it speaks
+ * the compact format, a missing @key falls back to entry @pos.
+ *
+ * Return codes are those of remote_cmd_get_i32().
+ */
+int32_t remote_cmd_get_i32_at(const remote_cmd_t *cmd, cmd_key_t key, \
+                              uint32_t pos, int32_t *value)
+{
+    const payload_t *entry;
+    int32_t ret;
+
+    ret = remote_cmd_get_i32(cmd, key, value);
+    if (ret != -ENOENT || dbus_peer_is_compact())
+        return ret;
+
+    if (pos >= cmd->entry_count)
+        return -ENOENT;
+
+    entry = &cmd->entries[pos];
+    if (entry->data_type != DBUS_TYPE_INT32 && \
+        entry->data_type != DBUS_TYPE_UINT32)
+        return -EPROTO;
+
+    *value = entry->value.i32;
+    return 0;
+}
+
+/*
+ * remote_cmd_get_str - String value of @key in @cmd
+ *
+ * The string belongs to @cmd. Return codes are those of remote_cmd_get_i32().
+ */
+int32_t remote_cmd_get_str(const remote_cmd_t *cmd, cmd_key_t key, \
+                           const char **value)
+{
+    const payload_t *entry;
+
+    entry = find_entry(cmd, key);
+    if (!entry)
+        return -ENOENT;
+
+    if (entry->data_type != DBUS_TYPE_STRING) {
+        LOG_WARN("Key [%s] is not a string", key_names[key]);
+        return -EPROTO;
+    }
+
+    *value = entry->value.str;
+    return 0;
+}
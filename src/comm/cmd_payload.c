@@ -17,9 +17,11 @@
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <stdatomic.h>
 
 #include "comm/dbus_comm.h"
 #include "comm/cmd_payload.h"
+#include "mem/obj_pool.h"
 #include "sched/workqueue.h"
 
 /*********************
@@ -41,6 +43,13 @@
 /**********************
  *  STATIC VARIABLES
  **********************/
+static obj_pool_t remote_cmd_pool = \
+    OBJ_POOL_INITIALIZER("remote_cmd", remote_cmd_t);
+static obj_pool_t local_cmd_pool = \
+    OBJ_POOL_INITIALIZER("local_cmd", local_cmd_t);
+
+/* Last message ID handed out, replies are matched on it */
+static atomic_uint last_umid;
 
 /**********************
  *      MACROS
@@ -49,6 +58,22 @@
 /**********************
  *   STATIC FUNCTIONS
  **********************/
+static work_t *create_remote_work(uint8_t priority, remote_cmd_t *cmd)
+{
+    work_t *work;
+
+    if (!cmd)
+        return NULL;
+
+    /* Sending follows the command duration, slow requests use long workers */
+    work = create_work(WORK_TYPE_REMOTE, priority, cmd->duration, \
+                       OP_DBUS_SENT_CMD, cmd);
+    if (!work) {
+        LOG_ERROR("Failed to create work from cmd");
+    }
+
+    return work;
+}
 
 /**********************
  *   GLOBAL FUNCTIONS
@@ -57,11 +82,14 @@ remote_cmd_t *create_remote_cmd()
 {
     remote_cmd_t *cmd;
 
-    cmd = calloc(1, sizeof(*cmd));
+    cmd = obj_pool_zalloc(&remote_cmd_pool);
     if (!cmd) {
         return NULL;
     }
 
+    cmd->entries = cmd->inline_entries;
+    cmd->entry_cap = REMOTE_CMD_INLINE_ENTRIES;
+
     return cmd;
 }
 
@@ -72,14 +100,19 @@ void delete_remote_cmd(remote_cmd_t *cmd)
         return;
     }
 
-    free(cmd);
+    /* Strings of a received command point into its message */
+    if (cmd->msg)
+        dbus_message_unref(cmd->msg);
+
+    arena_release(&cmd->arena);
+    obj_pool_free(&remote_cmd_pool, cmd);
 }
 
 local_cmd_t *create_local_cmd()
 {
     local_cmd_t *cmd = NULL;
 
-    cmd = calloc(1, sizeof(*cmd));
+    cmd = obj_pool_zalloc(&local_cmd_pool);
     if (!cmd) {
         return NULL;
     }
@@ -94,14 +127,12 @@ void delete_local_cmd(local_cmd_t *cmd)
         return;
     }
 
-    free(cmd);
+    obj_pool_free(&local_cmd_pool, cmd);
 }
 
 void remote_cmd_init(remote_cmd_t *cmd, const char *component_id, int32_t umid, \
                      int32_t opcode, uint8_t priority, uint8_t duration)
 {
-    int32_t i;
-
     cmd->component_id = component_id;
     cmd->umid = umid;
     cmd->opcode = opcode;
@@ -109,40 +140,108 @@ void remote_cmd_init(remote_cmd_t *cmd, const char *component_id, int32_t umid,
     cmd->duration = duration;
     cmd->entry_count = 0;
 
-    for (i = 0; i < MAX_ENTRIES; i++) {
-        cmd->entries[i].key = NULL;
-        cmd->entries[i].data_type = 0;
-        cmd->entries[i].data_length = 0;
+    arena_release(&cmd->arena);
+    cmd->entries = cmd->inline_entries;
+    cmd->entry_cap = REMOTE_CMD_INLINE_ENTRIES;
+    memset(cmd->key_slot, 0, sizeof(cmd->key_slot));
+}
+
+/*
+ * remote_cmd_reserve - Make room for @nr_entries entries in @cmd
+ *
+ * The entry array is moved to the command arena, sized to exactly
+ * @nr_entries so a decoded frame costs only what it carries.
+ *
+ * Return: 0 on success, -E2BIG above REMOTE_CMD_MAX_ENTRIES, -ENOMEM.
+ */
+int32_t remote_cmd_reserve(remote_cmd_t *cmd, uint32_t nr_entries)
+{
+    payload_t *entries;
+
+    if (nr_entries <= cmd->entry_cap)
+        return 0;
+
+    if (nr_entries > REMOTE_CMD_MAX_ENTRIES) {
+        LOG_ERROR("Command with %u entries, limit %d", nr_entries, \
+                  REMOTE_CMD_MAX_ENTRIES);
+        return -E2BIG;
     }
+
+    entries = arena_alloc(&cmd->arena, nr_entries * sizeof(*entries));
+    if (!entries)
+        return -ENOMEM;
+
+    memcpy(entries, cmd->entries, cmd->entry_count * sizeof(*entries));
+    cmd->entries = entries;
+    cmd->entry_cap = nr_entries;
+
+    return 0;
+}
+
+/*
+ * remote_cmd_new_entry - Append a zeroed entry to @cmd
+ *
+ * The entry array doubles when full, callers that know the final count
+ * should remote_cmd_reserve() it first.
+ *
+ * Return: the entry, or NULL when the command cannot grow.
+ */
+payload_t *remote_cmd_new_entry(remote_cmd_t *cmd)
+{
+    payload_t *entry;
+
+    if (cmd->entry_count == cmd->entry_cap && \
+        remote_cmd_reserve(cmd, cmd->entry_cap * 2))
+        return NULL;
+
+    entry = &cmd->entries[cmd->entry_count++];
+    memset(entry, 0, sizeof(*entry));
+
+    return entry;
 }
 
+/* The key and value are copied into the command */
 int32_t remote_cmd_add_string(remote_cmd_t *cmd, const char *key, const char *value)
 {
     payload_t *entry;
-    if (cmd->entry_count >= MAX_ENTRIES)
+
+    entry = remote_cmd_new_entry(cmd);
+    if (!entry)
         return -1;
 
-    entry = &cmd->entries[cmd->entry_count++];
-    entry->key = key;
+    entry->key = arena_strdup(&cmd->arena, key);
+    entry->value.str = arena_strdup(&cmd->arena, value);
+    if (!entry->key || !entry->value.str) {
+        cmd->entry_count--;
+        return -1;
+    }
+
     entry->data_type = DBUS_TYPE_STRING;
-    entry->data_length = strlen(value) + 1;;
-    entry->value.str = value;
+    entry->data_length = strlen(value) + 1;
+    remote_cmd_index_entry(cmd, cmd->entry_count - 1);
 
     return 0;
 }
 
+/* The key is copied into the command */
 int32_t remote_cmd_add_int(remote_cmd_t *cmd, const char *key, int32_t value)
 {
     payload_t *entry;
 
-    if (cmd->entry_count >= MAX_ENTRIES)
+    entry = remote_cmd_new_entry(cmd);
+    if (!entry)
         return -1;
 
-    entry = &cmd->entries[cmd->entry_count++];
-    entry->key = key;
+    entry->key = arena_strdup(&cmd->arena, key);
+    if (!entry->key) {
+        cmd->entry_count--;
+        return -1;
+    }
+
     entry->data_type = DBUS_TYPE_INT32;
     entry->data_length = sizeof(int32_t);
     entry->value.i32 = value;
+    remote_cmd_index_entry(cmd, cmd->entry_count - 1);
 
     return 0;
 }
@@ -179,18 +278,72 @@ int32_t create_remote_task(uint8_t priority, void *data)
 {
     work_t *work;
 
-    work = create_work(WORK_TYPE_REMOTE, priority, WORK_DURATION_SHORT, \
-                       OP_DBUS_SENT_CMD, data);
-    if (!work) {
-        LOG_ERROR("Failed to create work from cmd");
+    work = create_remote_work(priority, data);
+    if (!work)
         return -EINVAL;
-    }
 
     push_work(get_wq(UI_WQ), work);
 
     return 0;
 }
 
+/*
+ * Same as create_remote_task() but returns a handle to wait for or cancel
+ * the request, to be dropped with work_handle_put(). The command data is
+ * released on failure.
+ */
+work_handle_t *create_remote_tracked_task(uint8_t priority, void *data)
+{
+    work_handle_t *h;
+    work_t *work;
+
+    work = create_remote_work(priority, data);
+    if (!work)
+        return NULL;
+
+    h = push_work_tracked(get_wq(UI_WQ), work, NULL, NULL);
+    if (!h)
+        delete_work(work);
+
+    return h;
+}
+
+/*
+ * Same as create_remote_task() but the command is only queued once
+ * @delay_ms has elapsed. The command data is released if the delayed
+ * task cannot be scheduled.
+ */
+int32_t create_remote_delayed_task(uint8_t priority, void *data, \
+                                   uint32_t delay_ms)
+{
+    work_t *work;
+    int32_t ret;
+
+    work = create_remote_work(priority, data);
+    if (!work)
+        return -EINVAL;
+
+    ret = queue_delayed_work(get_wq(UI_WQ), work, delay_ms);
+    if (ret < 0) {
+        delete_work(work);
+        return ret;
+    }
+
+    return 0;
+}
+
+/* Message ID unique to this run, never 0 */
+uint32_t remote_cmd_next_umid(void)
+{
+    uint32_t umid;
+
+    do {
+        umid = atomic_fetch_add(&last_umid, 1) + 1;
+    } while (!umid);
+
+    return umid;
+}
+
 remote_cmd_t *create_remote_task_data(uint8_t priority, uint8_t duration, \
                                       uint32_t opcode)
 {
@@ -201,7 +354,7 @@ remote_cmd_t *create_remote_task_data(uint8_t priority, uint8_t duration, \
         return NULL;
     }
 
-    remote_cmd_init(cmd, COMP_NAME, COMP_ID, opcode, priority, duration);
+    remote_cmd_init(cmd, COMP_NAME, remote_cmd_next_umid(), opcode, priority, duration);
 
     return cmd;
 }
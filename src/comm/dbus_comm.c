@@ -15,29 +15,91 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/epoll.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/eventfd.h>
 #include <inttypes.h>
 #include <dbus/dbus.h>
 
+#include "list.h"
+#include "util.h"
 #include "comm/dbus_comm.h"
 #include "comm/f_comm.h"
+#include "comm/frame_codec.h"
 #include "comm/cmd_payload.h"
+#include "comm/dbus_req.h"
+#include "comm/dbus_resync.h"
+#include "mem/obj_pool.h"
+#include "mem/str_intern.h"
+#include "sched/op_handler.h"
 #include "sched/workqueue.h"
+#include "sched/wq_stats.h"
 #include "main.h"
 
 /*********************
  *      DEFINES
  *********************/
-#define MAX_EVENTS 2
+#define MAX_EVENTS 8
+#define RX_BATCH_MAX                    32  /* Works handed over at once */
+#define DBUS_MAX_WATCHES                4   /* libdbus uses one per direction */
+#define DBUS_MAX_TIMEOUTS               8
+#define TX_INFLIGHT_MAX_MS              500 /* Give up waiting for a reply */
 
 /**********************
  *      TYPEDEFS
  **********************/
+/* Works decoded from the messages of one wakeup, not queued yet */
+typedef struct {
+    workqueue_t *wq;
+    work_t *works[RX_BATCH_MAX];
+    int32_t nr;
+} rx_batch_t;
+
+/* Encoded message waiting for the listener thread to send it */
+typedef struct tx_msg {
+    struct list_head node;
+    DBusMessage *msg;
+    uint32_t umid;
+    uint32_t opcode;
+} tx_msg_t;
+
+/*
+ * Outgoing opcode sent at most once per interval_ms, and not while its
+ * previous call waits for a reply. Meanwhile only the latest message is
+ * held, older ones are dropped.
+ */
+typedef struct {
+    uint32_t opcode;
+    uint32_t interval_ms;
+    tx_msg_t *held;
+    uint32_t inflight_serial;           /* 0 when no reply is awaited */
+    uint64_t inflight_until_ns;
+    uint64_t next_ns;                   /* Earliest time of the next send */
+    uint32_t sent;
+    uint32_t dropped;
+} tx_coalesce_t;
+
+/*
+ * Watches and timeouts libdbus asked the listener loop to serve. A watch
+ * is polled through the epoll set by its fd, a timeout through the
+ * epoll_wait() timeout.
+ */
+typedef struct {
+    int32_t epoll_fd;
+    DBusWatch *watches[DBUS_MAX_WATCHES];
+    int32_t nr_watches;
+    DBusTimeout *timeouts[DBUS_MAX_TIMEOUTS];
+    uint64_t deadline_ns[DBUS_MAX_TIMEOUTS];
+    int32_t nr_timeouts;
+} dbus_loop_t;
 
 /**********************
  *  GLOBAL VARIABLES
@@ -46,10 +108,45 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void tx_coalesce_reply(DBusConnection *conn, DBusMessage *reply);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+/* Only touched by the DBus listener thread */
+static rx_batch_t rx_batch;
+static uint32_t rx_dropped;             /* Reports dropped under load */
+static dbus_loop_t loop;
+
+/*
+ * Outgoing messages. Workers only queue them and kick tx_event, the
+ * connection itself is used by the listener thread alone. tx_event is -1
+ * while the listener is not running.
+ */
+static pthread_mutex_t tx_lock = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(tx_queue);
+static int32_t tx_event = -1;
+static obj_pool_t tx_pool = OBJ_POOL_INITIALIZER("dbus_tx", tx_msg_t);
+
+/* High-rate UI controls, only touched by the DBus listener thread */
+static tx_coalesce_t tx_coalesced[] = {
+    { .opcode = OP_ADJUST_BRIGHTNESS, .interval_ms = 50 },
+};
+
+/*
+ * Frames are sent in the legacy format until the peer shows it speaks the
+ * compact one by sending a compact frame itself.
+ */
+static atomic_bool peer_compact;
+
+/*
+ * Whether sys-mgr owns its bus name, and whether the listener ran before.
+ * The peer showing up again after that is resynced. Only touched by the
+ * DBus listener thread.
+ */
+static bool peer_up;
+static bool link_started;
+static bool peer_on_bus;                /* Owner state seen on connect */
 
 /**********************
  *      MACROS
@@ -58,141 +155,109 @@
 /**********************
  *   STATIC FUNCTIONS
  **********************/
-// Encode remote_cmd_t into an existing DBusMessage
-static int32_t encode_data_frame(DBusMessage *msg, const remote_cmd_t *cmd)
+static void rx_batch_flush(void)
 {
-    DBusMessageIter iter, array_iter, struct_iter, variant_iter;
-
-    dbus_message_iter_init_append(msg, &iter);
-
-    dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &cmd->component_id);
-    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &cmd->umid);
-    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &cmd->opcode);
-    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &cmd->prio);
-    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &cmd->duration);
-
-    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(siiv)", &array_iter);
+    if (!rx_batch.nr)
+        return;
 
-    for (int32_t i = 0; i < cmd->entry_count; ++i) {
-        const payload_t *entry = &cmd->entries[i];
+    push_work_batch(rx_batch.wq, rx_batch.works, rx_batch.nr);
+    rx_batch.nr = 0;
+}
 
-        dbus_message_iter_open_container(&array_iter, DBUS_TYPE_STRUCT, NULL, &struct_iter);
+/* A batch goes to a single workqueue, switching queues flushes it */
+static void rx_batch_add(workqueue_t *wq, work_t *work)
+{
+    if (rx_batch.nr && rx_batch.wq != wq)
+        rx_batch_flush();
 
-        dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &entry->key);
-        dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT32, &entry->data_type);
-        dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT32, &entry->data_length);
+    rx_batch.wq = wq;
+    rx_batch.works[rx_batch.nr++] = work;
+    if (rx_batch.nr == RX_BATCH_MAX)
+        rx_batch_flush();
+}
 
-        const char *sig = NULL;
-        switch (entry->data_type) {
-            case DBUS_TYPE_STRING: sig = "s"; break;
-            case DBUS_TYPE_INT32:  sig = "i"; break;
-            case DBUS_TYPE_UINT32: sig = "u"; break;
-            case DBUS_TYPE_DOUBLE: sig = "d"; break;
-            default:
-                LOG_ERROR("Unsupported data_type %d for key '%s'", entry->data_type, entry->key);
-                return -EINVAL;
-        }
+/*
+ * Hand @cmd to the route of its opcode: the UI thread, or a work on the
+ * handler workqueue. Reports marked droppable are refused while that
+ * queue is backed up, unless they can replace a pending report of their
+ * opcode: the newest one is kept, the stale one dropped. UI thread ones
+ * are dropped while the UI lane is full.
+ */
+static int32_t route_cmd(remote_cmd_t *cmd)
+{
+    const op_entry_t *ent;
+    workqueue_t *wq;
+    work_t *work;
+    bool backed_up;
+    int32_t ret;
 
-        dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_VARIANT, sig, &variant_iter);
+    ent = op_lookup(cmd->opcode);
+    if (!ent) {
+        LOG_WARN("No handler for opcode [%d], frame dropped", cmd->opcode);
+        delete_remote_cmd(cmd);
+        return -ENOENT;
+    }
 
-        switch (entry->data_type) {
-            case DBUS_TYPE_STRING:
-                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_STRING, &entry->value.str);
-                break;
-            case DBUS_TYPE_INT32:
-                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_INT32, &entry->value.i32);
-                break;
-            case DBUS_TYPE_UINT32:
-                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_UINT32, &entry->value.u32);
-                break;
-            case DBUS_TYPE_DOUBLE:
-                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_DOUBLE, &entry->value.dbl);
-                break;
+    if (ent->flags & OP_F_UI_THREAD) {
+        /* The listener does not wait on a frame, a full lane drops it */
+        ret = op_post_ui(cmd);
+        if (ret == -EAGAIN) {
+            LOG_TRACE("UI lane full, opcode [%d] dropped", cmd->opcode);
+            rx_dropped++;
+            delete_remote_cmd(cmd);
+            return 0;
         }
-
-        dbus_message_iter_close_container(&struct_iter, &variant_iter);
-        dbus_message_iter_close_container(&array_iter, &struct_iter);
+        if (ret)
+            delete_remote_cmd(cmd);
+        return ret;
     }
 
-    dbus_message_iter_close_container(&iter, &array_iter);
-    return 0;
-}
-
-// Decode DBusMessage into remote_cmd_t
-static int32_t decode_data_frame(DBusMessage *msg, remote_cmd_t *out)
-{
-    DBusMessageIter iter, array_iter, struct_iter, variant_iter;
-
-    if (!dbus_message_iter_init(msg, &iter)) {
-        LOG_ERROR("Failed to init DBus iterator");
+    wq = get_wq(ent->wq);
+    if (!wq) {
+        delete_remote_cmd(cmd);
         return -EINVAL;
     }
 
-    dbus_message_iter_get_basic(&iter, &out->component_id);
-    dbus_message_iter_next(&iter);
-
-    dbus_message_iter_get_basic(&iter, &out->umid);
-    dbus_message_iter_next(&iter);
-
-    dbus_message_iter_get_basic(&iter, &out->opcode);
-    dbus_message_iter_next(&iter);
-
-    dbus_message_iter_get_basic(&iter, &out->prio);
-    dbus_message_iter_next(&iter);
-
-    dbus_message_iter_get_basic(&iter, &out->duration);
-    dbus_message_iter_next(&iter);
-
-    dbus_message_iter_recurse(&iter, &array_iter);
-
-    int32_t i = 0;
-    while (dbus_message_iter_get_arg_type(&array_iter) == DBUS_TYPE_STRUCT && \
-           i < MAX_ENTRIES) {
-        payload_t *entry = &out->entries[i];
-        dbus_message_iter_recurse(&array_iter, &struct_iter);
-
-        dbus_message_iter_get_basic(&struct_iter, &entry->key);
-        dbus_message_iter_next(&struct_iter);
-
-        dbus_message_iter_get_basic(&struct_iter, &entry->data_type);
-        dbus_message_iter_next(&struct_iter);
-
-        dbus_message_iter_get_basic(&struct_iter, &entry->data_length);
-        dbus_message_iter_next(&struct_iter);
+    backed_up = (ent->flags & OP_F_DROPPABLE) && \
+                workqueue_active_count(wq) >= OP_DROP_DEPTH;
+    if (backed_up && !(ent->flags & OP_F_COALESCE)) {
+        LOG_TRACE("Queue backed up, opcode [%d] dropped", cmd->opcode);
+        rx_dropped++;
+        delete_remote_cmd(cmd);
+        return 0;
+    }
 
-        dbus_message_iter_recurse(&struct_iter, &variant_iter);
+    work = create_work(WORK_TYPE_REMOTE, ent->prio == OP_PRIO_FRAME ? \
+                       cmd->prio : ent->prio, cmd->duration, cmd->opcode, \
+                       (void *)cmd);
+    if (!work) {
+        LOG_ERROR("Failed to create work from cmd");
+        delete_remote_cmd(cmd);
+        return -ENOMEM;
+    }
 
-        switch (entry->data_type) {
-            case DBUS_TYPE_STRING:
-                dbus_message_iter_get_basic(&variant_iter, &entry->value.str);
-                break;
-            case DBUS_TYPE_INT32:
-                dbus_message_iter_get_basic(&variant_iter, &entry->value.i32);
-                break;
-            case DBUS_TYPE_UINT32:
-                dbus_message_iter_get_basic(&variant_iter, &entry->value.u32);
-                break;
-            case DBUS_TYPE_DOUBLE:
-                dbus_message_iter_get_basic(&variant_iter, &entry->value.dbl);
-                break;
-            default:
-                LOG_WARN("Unsupported type %d for entry %d", entry->data_type, i);
-                break;
+    if (ent->flags & OP_F_COALESCE) {
+        /* Keep arrival order with the frames batched before this one */
+        rx_batch_flush();
+        if (!backed_up) {
+            push_work_coalesce(wq, work, 0);
+        } else if (replace_pending_work(wq, work, 0) <= 0) {
+            LOG_TRACE("Queue backed up, opcode [%d] dropped", \
+                      work->opcode);
+            rx_dropped++;
+            delete_work(work);
         }
-
-        dbus_message_iter_next(&array_iter);
-        i++;
+    } else {
+        rx_batch_add(wq, work);
     }
 
-    out->entry_count = i;
     return 0;
 }
 
 static int32_t dispatch_cmd_from_message(DBusMessage *msg)
 {
     remote_cmd_t *cmd;
-    work_t *work;
-    int32_t i;
+    int32_t i, fmt;
 
     cmd = create_remote_cmd();
     if (!cmd) {
@@ -200,12 +265,24 @@ static int32_t dispatch_cmd_from_message(DBusMessage *msg)
         return -ENOMEM;
     }
 
-    if (decode_data_frame(msg, cmd)) {
+    fmt = decode_data_frame(msg, cmd);
+    if (fmt < 0) {
         LOG_ERROR("Failed to decode DBus message");
         delete_remote_cmd(cmd);
         return -EINVAL;
     }
 
+    if (fmt == FRAME_FMT_COMPACT && !atomic_load(&peer_compact)) {
+        LOG_INFO("Peer sends compact frames, switching to them");
+        atomic_store(&peer_compact, true);
+    }
+
+    /*
+     * The decoded strings live in the message buffer, keep the message
+     * until the command is deleted along with its work.
+     */
+    cmd->msg = dbus_message_ref(msg);
+
     LOG_DEBUG("Received frame from component: %s", cmd->component_id);
     LOG_DEBUG("Message ID: %d, Opcode: %d, Prio %d, Duration %d", cmd->umid, \
               cmd->opcode, cmd->prio, cmd->duration);
@@ -227,16 +304,7 @@ static int32_t dispatch_cmd_from_message(DBusMessage *msg)
         }
     }
 
-    work = create_work(WORK_TYPE_REMOTE, cmd->prio, cmd->duration, \
-                       cmd->opcode, (void *)cmd);
-    if (!work) {
-        LOG_ERROR("Failed to create work from cmd");
-        delete_remote_cmd(cmd);
-        return -ENOMEM;
-    }
-
-    push_work(get_wq(UI_WQ), work);
-    return 0;
+    return route_cmd(cmd);
 }
 
 static int32_t handle_method_call(DBusConnection *conn, DBusMessage *msg)
@@ -246,18 +314,12 @@ static int32_t handle_method_call(DBusConnection *conn, DBusMessage *msg)
     const char *reply_str = "Method reply OK";
     int32_t ret;
 
-    const char *iface = dbus_message_get_interface(msg);
-    const char *member = dbus_message_get_member(msg);
-
-    if (!iface || !member)
-        return -EINVAL;
-
-    if (strcmp(iface, SER_IFACE) || strcmp(member, SER_METH))
+    if (!dbus_message_is_method_call(msg, SER_IFACE, SER_METH))
         return 0; /* not our method */
 
     ret = dispatch_cmd_from_message(msg);
     if (ret < 0) {
-        LOG_ERROR("Dispatch failed: iface=%s, meth=%s", iface, member);
+        LOG_ERROR("Dispatch failed: iface=%s, meth=%s", SER_IFACE, SER_METH);
         reply = dbus_message_new_error(msg, DBUS_ERROR_FAILED,
                                        "Dispatch failed");
     } else {
@@ -274,21 +336,62 @@ static int32_t handle_method_call(DBusConnection *conn, DBusMessage *msg)
     return ret;
 }
 
+static void peer_set_up(bool up)
+{
+    if (up == peer_up)
+        return;
+
+    peer_up = up;
+    if (!up) {
+        LOG_WARN("System manager left the bus");
+        /* A restarted peer may not speak the compact format */
+        atomic_store(&peer_compact, false);
+        dbus_resync_link_lost();
+        return;
+    }
+
+    LOG_INFO("System manager is on the bus");
+    if (link_started)
+        dbus_resync_start();
+}
+
+/* The bus reports every owner change of REMOTE_SER_NAME */
+static void handle_owner_changed(DBusMessage *msg)
+{
+    const char *name, *old_owner, *new_owner;
+
+    if (!dbus_message_get_args(msg, NULL, DBUS_TYPE_STRING, &name, \
+                               DBUS_TYPE_STRING, &old_owner, \
+                               DBUS_TYPE_STRING, &new_owner, \
+                               DBUS_TYPE_INVALID))
+        return;
+
+    if (strcmp(name, REMOTE_SER_NAME))
+        return;
+
+    if (*old_owner)
+        peer_set_up(false);
+    if (*new_owner)
+        peer_set_up(true);
+}
+
 static int32_t handle_signal(DBusMessage *msg)
 {
     int32_t ret;
-    const char *iface = dbus_message_get_interface(msg);
-    const char *member = dbus_message_get_member(msg);
 
-    if (!iface || !member)
-        return -EINVAL;
+    if (dbus_message_is_signal(msg, DBUS_INTERFACE_DBUS, "NameOwnerChanged")) {
+        handle_owner_changed(msg);
+        return 0;
+    }
 
-    if (strcmp(iface, LISTEN_IFACE) || strcmp(member, LISTEN_SIG))
+    /* The match rule only subscribes to these, bus signals still come */
+    if (!dbus_message_is_signal(msg, LISTEN_IFACE, LISTEN_SIG))
         return 0; /* not our signal */
 
     ret = dispatch_cmd_from_message(msg);
-    if (ret < 0)
-        LOG_ERROR("Dispatch signal failed: %s.%s", iface, member);
+    if (ret < 0) {
+        LOG_ERROR("Dispatch signal failed: %s.%s", LISTEN_IFACE, LISTEN_SIG);
+    }
 
     return ret;
 }
@@ -303,28 +406,522 @@ static void handle_message(DBusConnection *conn, DBusMessage *msg)
         handle_signal(msg);
         break;
     case DBUS_MESSAGE_TYPE_METHOD_RETURN:
-        LOG_TRACE("Dbus method return detected");
+    case DBUS_MESSAGE_TYPE_ERROR:
+        tx_coalesce_reply(conn, msg);
+        if (!dbus_req_reply(msg)) {
+            LOG_TRACE("Dbus reply to an untracked call detected");
+        }
         break;
     default:
         break;
     }
 }
 
-static int32_t dbus_connection_event_handler(DBusConnection *conn)
+static void dbus_drain_incoming(DBusConnection *conn)
 {
     DBusMessage *msg;
 
-    if (!dbus_connection_read_write_dispatch(conn, 0))
-        return 0;
-
+    /* Everything drained in this wakeup reaches the workers in one go */
     while ((msg = dbus_connection_pop_message(conn)) != NULL) {
         handle_message(conn, msg);
         dbus_message_unref(msg);
     }
+    rx_batch_flush();
+}
+
+/*=====================
+ * Watches
+ *====================*/
+/* Poll @fd for what its enabled watches want, or drop it from the set */
+static void watch_update_fd(int32_t fd, bool was_polled)
+{
+    struct epoll_event ev = { .data.fd = fd };
+    DBusWatch *watch;
+    uint32_t flags;
+    bool polled = false;
+    int32_t i;
+
+    for (i = 0; i < loop.nr_watches; i++) {
+        watch = loop.watches[i];
+        if (dbus_watch_get_unix_fd(watch) != fd)
+            continue;
+
+        polled = true;
+        if (!dbus_watch_get_enabled(watch))
+            continue;
+
+        flags = dbus_watch_get_flags(watch);
+        if (flags & DBUS_WATCH_READABLE)
+            ev.events |= EPOLLIN;
+        if (flags & DBUS_WATCH_WRITABLE)
+            ev.events |= EPOLLOUT;
+    }
+
+    if (!polled) {
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    } else if (epoll_ctl(loop.epoll_fd, was_polled ? EPOLL_CTL_MOD : \
+                         EPOLL_CTL_ADD, fd, &ev) == -1) {
+        LOG_ERROR("Failed to poll DBus fd %d: %s", fd, strerror(errno));
+    }
+}
+
+static bool watch_fd_polled(int32_t fd)
+{
+    int32_t i;
+
+    for (i = 0; i < loop.nr_watches; i++) {
+        if (dbus_watch_get_unix_fd(loop.watches[i]) == fd)
+            return true;
+    }
+
+    return false;
+}
+
+static dbus_bool_t add_watch(DBusWatch *watch, void *data __maybe_unused)
+{
+    int32_t fd = dbus_watch_get_unix_fd(watch);
+    bool was_polled;
+
+    if (loop.nr_watches == DBUS_MAX_WATCHES) {
+        LOG_ERROR("Too many DBus watches");
+        return FALSE;
+    }
+
+    was_polled = watch_fd_polled(fd);
+    loop.watches[loop.nr_watches++] = watch;
+    watch_update_fd(fd, was_polled);
+
+    return TRUE;
+}
+
+static void remove_watch(DBusWatch *watch, void *data __maybe_unused)
+{
+    int32_t fd = dbus_watch_get_unix_fd(watch);
+    int32_t i;
+
+    for (i = 0; i < loop.nr_watches; i++) {
+        if (loop.watches[i] == watch) {
+            loop.watches[i] = loop.watches[--loop.nr_watches];
+            watch_update_fd(fd, true);
+            return;
+        }
+    }
+}
+
+static void toggle_watch(DBusWatch *watch, void *data __maybe_unused)
+{
+    watch_update_fd(dbus_watch_get_unix_fd(watch), true);
+}
+
+/* Enabled watch of @fd interested in @flags, looked up afresh each time */
+static DBusWatch *find_watch(int32_t fd, uint32_t flags)
+{
+    DBusWatch *watch;
+    int32_t i;
+
+    for (i = 0; i < loop.nr_watches; i++) {
+        watch = loop.watches[i];
+        if (dbus_watch_get_unix_fd(watch) == fd && \
+            dbus_watch_get_enabled(watch) && \
+            (dbus_watch_get_flags(watch) & flags))
+            return watch;
+    }
+
+    return NULL;
+}
+
+/*
+ * Hand epoll @events on @fd to the watches. A watch may add or remove
+ * watches while handled, so each one is looked up again.
+ *
+ * Return: false if @fd does not belong to a watch.
+ */
+static bool handle_watch_events(int32_t fd, uint32_t events)
+{
+    uint32_t err = 0;
+    DBusWatch *watch;
+
+    if (!watch_fd_polled(fd))
+        return false;
+
+    if (events & EPOLLERR)
+        err |= DBUS_WATCH_ERROR;
+    if (events & EPOLLHUP)
+        err |= DBUS_WATCH_HANGUP;
+
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        watch = find_watch(fd, DBUS_WATCH_READABLE);
+        if (watch)
+            dbus_watch_handle(watch, DBUS_WATCH_READABLE | err);
+    }
+
+    if (events & EPOLLOUT) {
+        watch = find_watch(fd, DBUS_WATCH_WRITABLE);
+        if (watch)
+            dbus_watch_handle(watch, DBUS_WATCH_WRITABLE);
+    }
+
+    return true;
+}
+
+/*=====================
+ * Timeouts
+ *====================*/
+static void timeout_arm(int32_t idx)
+{
+    DBusTimeout *timeout = loop.timeouts[idx];
+
+    loop.deadline_ns[idx] = dbus_timeout_get_enabled(timeout) ? \
+        now_ns() + \
+        (uint64_t)dbus_timeout_get_interval(timeout) * NSEC_PER_MSEC : 0;
+}
+
+static int32_t find_timeout(DBusTimeout *timeout)
+{
+    int32_t i;
+
+    for (i = 0; i < loop.nr_timeouts; i++) {
+        if (loop.timeouts[i] == timeout)
+            return i;
+    }
+
+    return -1;
+}
+
+static dbus_bool_t add_timeout(DBusTimeout *timeout, \
+                               void *data __maybe_unused)
+{
+    if (loop.nr_timeouts == DBUS_MAX_TIMEOUTS) {
+        LOG_ERROR("Too many DBus timeouts");
+        return FALSE;
+    }
+
+    loop.timeouts[loop.nr_timeouts] = timeout;
+    timeout_arm(loop.nr_timeouts++);
+
+    return TRUE;
+}
+
+static void remove_timeout(DBusTimeout *timeout, void *data __maybe_unused)
+{
+    int32_t idx = find_timeout(timeout);
+
+    if (idx < 0)
+        return;
+
+    loop.nr_timeouts--;
+    loop.timeouts[idx] = loop.timeouts[loop.nr_timeouts];
+    loop.deadline_ns[idx] = loop.deadline_ns[loop.nr_timeouts];
+}
+
+static void toggle_timeout(DBusTimeout *timeout, void *data __maybe_unused)
+{
+    int32_t idx = find_timeout(timeout);
+
+    if (idx >= 0)
+        timeout_arm(idx);
+}
+
+/* epoll_wait() timeout until the next armed timeout, -1 if none */
+static int32_t next_timeout_ms(void)
+{
+    uint64_t now = now_ns(), next = UINT64_MAX;
+    int32_t i;
+
+    for (i = 0; i < loop.nr_timeouts; i++) {
+        if (loop.deadline_ns[i] && loop.deadline_ns[i] < next)
+            next = loop.deadline_ns[i];
+    }
+
+    if (next == UINT64_MAX)
+        return -1;
+    if (next <= now)
+        return 0;
+
+    return (int32_t)((next - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC);
+}
+
+/*
+ * Fire the expired timeouts. Each is re-armed before it is handled, as
+ * libdbus timeouts repeat until removed, and the handler may change the set.
+ */
+static void handle_timeouts(void)
+{
+    uint64_t now = now_ns();
+    DBusTimeout *timeout;
+    int32_t i;
+
+    do {
+        timeout = NULL;
+        for (i = 0; i < loop.nr_timeouts; i++) {
+            if (loop.deadline_ns[i] && loop.deadline_ns[i] <= now) {
+                timeout = loop.timeouts[i];
+                timeout_arm(i);
+                break;
+            }
+        }
+
+        if (timeout)
+            dbus_timeout_handle(timeout);
+    } while (timeout);
+}
+
+/*=====================
+ * Outgoing queue
+ *====================*/
+/* Queue @msg for the listener thread, the queue takes the reference */
+static int32_t tx_queue_msg(DBusMessage *msg, uint32_t umid, uint32_t opcode)
+{
+    tx_msg_t *tx;
+
+    pthread_mutex_lock(&tx_lock);
+    if (tx_event < 0) {
+        pthread_mutex_unlock(&tx_lock);
+        return -EIO;
+    }
+
+    tx = obj_pool_alloc(&tx_pool);
+    if (!tx) {
+        pthread_mutex_unlock(&tx_lock);
+        return -ENOMEM;
+    }
+
+    tx->msg = msg;
+    tx->umid = umid;
+    tx->opcode = opcode;
+    list_add_tail(&tx->node, &tx_queue);
+    event_set(tx_event, 1);
+    pthread_mutex_unlock(&tx_lock);
 
     return 0;
 }
 
+/* Move the queued messages to @out, taking them off the shared queue */
+static void tx_take_all(struct list_head *out)
+{
+    tx_msg_t *tx, *tmp;
+
+    pthread_mutex_lock(&tx_lock);
+    list_for_each_entry_safe(tx, tmp, &tx_queue, node) {
+        list_del(&tx->node);
+        list_add_tail(&tx->node, out);
+    }
+    pthread_mutex_unlock(&tx_lock);
+}
+
+static void tx_release(tx_msg_t *tx)
+{
+    dbus_message_unref(tx->msg);
+    obj_pool_free(&tx_pool, tx);
+}
+
+/*
+ * Hand @tx to libdbus. It writes what the socket takes at once and enables
+ * the write watch for the rest, nothing blocks here.
+ *
+ * Return: the serial of the message, 0 if it was not sent.
+ */
+static uint32_t tx_send(DBusConnection *conn, tx_msg_t *tx)
+{
+    uint32_t serial = 0;
+
+    if (dbus_req_send(conn, tx->msg, tx->umid)) {
+        serial = dbus_message_get_serial(tx->msg);
+    } else {
+        LOG_ERROR("Out of memory while sending message");
+    }
+
+    tx_release(tx);
+    return serial;
+}
+
+/*=====================
+ * Outgoing coalescing
+ *====================*/
+static tx_coalesce_t *tx_coalesce_find(uint32_t opcode)
+{
+    int32_t i;
+
+    for (i = 0; i < ARRAY_SIZE(tx_coalesced); i++) {
+        if (tx_coalesced[i].opcode == opcode)
+            return &tx_coalesced[i];
+    }
+
+    return NULL;
+}
+
+/* When the held message of @co may go, 0 if nothing is held */
+static uint64_t tx_coalesce_due_ns(const tx_coalesce_t *co)
+{
+    if (!co->held)
+        return 0;
+
+    if (co->inflight_serial && co->inflight_until_ns > co->next_ns)
+        return co->inflight_until_ns;
+
+    return co->next_ns;
+}
+
+/* Send the held message of @co once both the window and the reply allow */
+static void tx_coalesce_kick(DBusConnection *conn, tx_coalesce_t *co, \
+                             uint64_t now)
+{
+    tx_msg_t *tx = co->held;
+    uint32_t serial;
+    bool is_call;
+
+    if (!tx || tx_coalesce_due_ns(co) > now)
+        return;
+
+    co->held = NULL;
+    co->next_ns = now + (uint64_t)co->interval_ms * NSEC_PER_MSEC;
+    co->inflight_until_ns = now + TX_INFLIGHT_MAX_MS * NSEC_PER_MSEC;
+    co->sent++;
+
+    is_call = dbus_message_get_type(tx->msg) == DBUS_MESSAGE_TYPE_METHOD_CALL;
+    serial = tx_send(conn, tx);
+
+    /* Signals get no reply, only method calls hold the next send back */
+    co->inflight_serial = is_call ? serial : 0;
+}
+
+/* Keep @tx as the latest message of @co, replacing the one not sent yet */
+static void tx_coalesce_hold(DBusConnection *conn, tx_coalesce_t *co, \
+                             tx_msg_t *tx)
+{
+    if (co->held) {
+        LOG_TRACE("Coalesced outgoing opcode %u", co->opcode);
+        dbus_req_abort(co->held->umid, -ECANCELED);
+        tx_release(co->held);
+        co->dropped++;
+    }
+
+    co->held = tx;
+    tx_coalesce_kick(conn, co, now_ns());
+}
+
+static void tx_coalesce_reply(DBusConnection *conn, DBusMessage *reply)
+{
+    uint32_t serial = dbus_message_get_reply_serial(reply);
+    int32_t i;
+
+    for (i = 0; i < ARRAY_SIZE(tx_coalesced); i++) {
+        if (serial && tx_coalesced[i].inflight_serial == serial) {
+            tx_coalesced[i].inflight_serial = 0;
+            tx_coalesce_kick(conn, &tx_coalesced[i], now_ns());
+            return;
+        }
+    }
+}
+
+/* Send what became due, return the next due time, 0 if none */
+static uint64_t tx_coalesce_run(DBusConnection *conn)
+{
+    uint64_t now = now_ns(), due, next = 0;
+    int32_t i;
+
+    for (i = 0; i < ARRAY_SIZE(tx_coalesced); i++) {
+        tx_coalesce_kick(conn, &tx_coalesced[i], now);
+
+        due = tx_coalesce_due_ns(&tx_coalesced[i]);
+        if (due && (!next || due < next))
+            next = due;
+    }
+
+    return next;
+}
+
+/* epoll_wait() timeout, the next libdbus timeout or coalesced send */
+static int32_t loop_wait_ms(uint64_t tx_due_ns)
+{
+    int32_t wait = next_timeout_ms(), tx_wait;
+    uint64_t now;
+
+    if (!tx_due_ns)
+        return wait;
+
+    now = now_ns();
+    tx_wait = tx_due_ns <= now ? 0 : \
+              (int32_t)((tx_due_ns - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC);
+
+    return (wait < 0 || tx_wait < wait) ? tx_wait : wait;
+}
+
+static void tx_coalesce_dump_stats(void)
+{
+    int32_t i;
+
+    for (i = 0; i < ARRAY_SIZE(tx_coalesced); i++) {
+        LOG_INFO("Opcode %2u tx     : sent %u, coalesced %u", \
+                 tx_coalesced[i].opcode, tx_coalesced[i].sent, \
+                 tx_coalesced[i].dropped);
+    }
+}
+
+static void tx_flush(DBusConnection *conn)
+{
+    tx_coalesce_t *co;
+    tx_msg_t *tx, *tmp;
+    uint64_t val;
+    LIST_HEAD(pending);
+
+    event_get(tx_event, &val);
+    tx_take_all(&pending);
+
+    list_for_each_entry_safe(tx, tmp, &pending, node) {
+        list_del(&tx->node);
+        co = tx_coalesce_find(tx->opcode);
+        if (co)
+            tx_coalesce_hold(conn, co, tx);
+        else
+            tx_send(conn, tx);
+    }
+}
+
+static int32_t tx_open(void)
+{
+    int32_t fd;
+
+    fd = eventfd(0, EFD_NONBLOCK);
+    if (fd == -1)
+        return -errno;
+
+    pthread_mutex_lock(&tx_lock);
+    tx_event = fd;
+    pthread_mutex_unlock(&tx_lock);
+
+    return fd;
+}
+
+/* Refuse new messages and drop the unsent ones */
+static void tx_close(void)
+{
+    tx_msg_t *tx, *tmp;
+    LIST_HEAD(pending);
+    int32_t i;
+
+    pthread_mutex_lock(&tx_lock);
+    if (tx_event >= 0)
+        close(tx_event);
+    tx_event = -1;
+    pthread_mutex_unlock(&tx_lock);
+
+    for (i = 0; i < ARRAY_SIZE(tx_coalesced); i++) {
+        tx = tx_coalesced[i].held;
+        if (tx)
+            list_add_tail(&tx->node, &pending);
+        tx_coalesced[i].held = NULL;
+        tx_coalesced[i].inflight_serial = 0;
+    }
+
+    tx_take_all(&pending);
+    list_for_each_entry_safe(tx, tmp, &pending, node) {
+        list_del(&tx->node);
+        dbus_req_abort(tx->umid, -EIO);
+        tx_release(tx);
+    }
+}
+
 static int32_t set_dbus_signal_match_rule(DBusConnection *conn)
 {
     int32_t ret = 0;
@@ -335,17 +932,37 @@ static int32_t set_dbus_signal_match_rule(DBusConnection *conn)
         return -ENOMEM;
 
     snprintf(match_rule, 256,
-             "type='signal',interface='%s',member='%s',path='%s'",
-             LISTEN_IFACE, LISTEN_SIG, LISTEN_OBJ_PATH);
+             "type='signal',sender='%s',interface='%s',member='%s',path='%s'",
+             REMOTE_SER_NAME, LISTEN_IFACE, LISTEN_SIG, LISTEN_OBJ_PATH);
 
     ret = add_dbus_match_rule(conn, match_rule);
-    if (ret)
+    if (ret) {
         LOG_ERROR("Failed to add DBus match rule: %d", ret);
+        goto out;
+    }
 
+    /* Follow sys-mgr leaving and coming back */
+    snprintf(match_rule, 256,
+             "type='signal',sender='%s',interface='%s',"
+             "member='NameOwnerChanged',arg0='%s'",
+             DBUS_SERVICE_DBUS, DBUS_INTERFACE_DBUS, REMOTE_SER_NAME);
+
+    ret = add_dbus_match_rule(conn, match_rule);
+    if (ret) {
+        LOG_ERROR("Failed to add DBus owner match rule: %d", ret);
+    }
+
+out:
     free(match_rule);
     return ret;
 }
 
+static void close_dbus_connection(DBusConnection *conn)
+{
+    dbus_connection_close(conn);
+    dbus_connection_unref(conn);
+}
+
 static DBusConnection *setup_dbus_connection()
 {
     DBusConnection *conn = NULL;
@@ -354,7 +971,8 @@ static DBusConnection *setup_dbus_connection()
 
     dbus_error_init(&err);
 
-    conn = dbus_bus_get(SER_BUS_TYPE, &err);
+    /* Private, so a dropped connection can be closed and opened again */
+    conn = dbus_bus_get_private(SER_BUS_TYPE, &err);
     if (dbus_error_is_set(&err)) {
         LOG_ERROR("DBus connection Error: %s", err.message);
         dbus_error_free(&err);
@@ -362,6 +980,9 @@ static DBusConnection *setup_dbus_connection()
     if (!conn)
         return NULL;
 
+    /* libdbus calls _exit() on disconnection by default */
+    dbus_connection_set_exit_on_disconnect(conn, FALSE);
+
     ret = dbus_bus_request_name(conn, \
                                 SER_NAME, \
                                 DBUS_NAME_FLAG_REPLACE_EXISTING, \
@@ -369,38 +990,61 @@ static DBusConnection *setup_dbus_connection()
     if (dbus_error_is_set(&err)) {
         LOG_FATAL("DBus request name error: %s", err.message);
         dbus_error_free(&err);
-        dbus_connection_unref(conn);
+        close_dbus_connection(conn);
         return NULL;
     }
     if (ret != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
-        dbus_connection_unref(conn);
+        close_dbus_connection(conn);
         return NULL;
     }
 
     return conn;
 }
 
+/* Service events, written by the main thread to the ctx event file */
+static void handle_ctx_event(void)
+{
+    uint64_t event_id = 0;
+
+    if (event_get(get_ctx()->comm.event, &event_id))
+        return;
+
+    if (event_id == SIGUSR2) {
+        wq_stats_dump();
+        obj_pool_dump_stats();
+        str_intern_dump_stats();
+        dbus_req_dump_stats();
+        tx_coalesce_dump_stats();
+        dbus_resync_dump_stats();
+        LOG_INFO("Reports dropped under load: %u", rx_dropped);
+    } else {
+        LOG_INFO("Received event ID [%" PRIu64 "], stopping DBus listener...", \
+                 event_id);
+    }
+}
+
+/*
+ * dbus_listener_loop - Serve @conn until the service stops
+ *
+ * Return: 0 once stopped, -ENOTCONN if the bus connection dropped, or
+ * another negative error if the loop could not run.
+ */
 static int32_t dbus_listener_loop(DBusConnection *conn)
 {
-    int32_t dbus_fd;
     int32_t epoll_fd;
+    int32_t tx_fd;
     struct epoll_event ev;
     struct epoll_event events_detected[MAX_EVENTS];
     int32_t n_ready;
     int32_t ready_fd;
+    uint64_t tx_due_ns = 0;
+    int32_t ret = 0;
 
     if (!conn) {
         LOG_ERROR("Invalid DBus connection");
         return -EINVAL; /* Invalid argument */
     }
 
-    // Get DBus file desc
-    dbus_connection_get_unix_fd(conn, &dbus_fd);
-    if (dbus_fd < 0) {
-        LOG_ERROR("Failed to get dbus fd");
-        return -EBADF; /* Bad file descriptor */
-    }
-
     // Create epoll file desc
     epoll_fd = epoll_create1(0);
     if (epoll_fd == -1) {
@@ -410,14 +1054,6 @@ static int32_t dbus_listener_loop(DBusConnection *conn)
 
     ev.events = EPOLLIN;
 
-    // Add DBus file desc
-    ev.data.fd = dbus_fd;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, dbus_fd, &ev) == -1) {
-        LOG_ERROR("Failed to add DBus fd to epoll: %s", strerror(errno));
-        close(epoll_fd);
-        return -errno;
-    }
-
     // Add Event file desc
     ev.data.fd = get_ctx()->comm.event;
     if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, get_ctx()->comm.event, &ev) == -1) {
@@ -426,38 +1062,136 @@ static int32_t dbus_listener_loop(DBusConnection *conn)
         return -errno;
     }
 
+    // Add outgoing queue file desc
+    tx_fd = tx_open();
+    if (tx_fd < 0) {
+        LOG_ERROR("Failed to create tx eventfd: %s", strerror(-tx_fd));
+        close(epoll_fd);
+        return tx_fd;
+    }
+
+    ev.data.fd = tx_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, tx_fd, &ev) == -1) {
+        LOG_ERROR("Failed to add tx fd to epoll: %s", strerror(errno));
+        ret = -errno;
+        goto exit_tx;
+    }
+
+    // Let libdbus poll the DBus socket and its timers through this loop
+    loop.epoll_fd = epoll_fd;
+    if (!dbus_connection_set_watch_functions(conn, add_watch, remove_watch, \
+                                             toggle_watch, NULL, NULL) || \
+        !dbus_connection_set_timeout_functions(conn, add_timeout, \
+                                               remove_timeout, \
+                                               toggle_timeout, NULL, NULL)) {
+        LOG_ERROR("Failed to hook DBus into the listener loop");
+        ret = -ENOMEM;
+        goto exit_watch;
+    }
+
+    /*
+     * The outgoing queue is open now, a resync burst of a returning peer
+     * can be sent. Owner changes missed while disconnected are caught up.
+     */
+    peer_set_up(peer_on_bus);
+    link_started = true;
+
+    /* Messages read along with the setup replies are already queued */
+    dbus_drain_incoming(conn);
+
     LOG_INFO("System manager DBus communication is running...");
     while (get_ctx()->run) {
         LOG_TRACE("[DBus]--> Waiting for next DBus message...");
-        n_ready = epoll_wait(epoll_fd, events_detected, MAX_EVENTS, -1);
+        n_ready = epoll_wait(epoll_fd, events_detected, MAX_EVENTS, \
+                             loop_wait_ms(tx_due_ns));
         if (n_ready == -1) {
             if (errno == EINTR) {
                 LOG_WARN("epoll_wait interrupted, continuing...");
                 continue;
             }
             LOG_ERROR("epoll_wait failed: %s", strerror(errno));
-            close(epoll_fd);
-            return -errno;
+            ret = -errno;
+            break;
         }
 
         for (int32_t cnt = 0; cnt < n_ready; cnt++) {
             ready_fd = events_detected[cnt].data.fd;
-            if (ready_fd == dbus_fd) {
-                dbus_connection_event_handler(conn);
+            if (ready_fd == tx_fd) {
+                tx_flush(conn);
             } else if (ready_fd == get_ctx()->comm.event) {
-                uint64_t event_id = 0;
-                if (!event_get(get_ctx()->comm.event, &event_id)) {
-                    LOG_INFO("Received event ID [%" PRIu64 "], stopping DBus listener...", \
-                             event_id);
-                }
+                handle_ctx_event();
+            } else {
+                handle_watch_events(ready_fd, events_detected[cnt].events);
             }
         }
+
+        handle_timeouts();
+        dbus_drain_incoming(conn);
+        if (!dbus_connection_get_is_connected(conn)) {
+            LOG_ERROR("DBus connection lost");
+            ret = -ENOTCONN;
+            break;
+        }
+        tx_due_ns = tx_coalesce_run(conn);
     }
 
+exit_watch:
+    dbus_connection_set_watch_functions(conn, NULL, NULL, NULL, NULL, NULL);
+    dbus_connection_set_timeout_functions(conn, NULL, NULL, NULL, NULL, NULL);
+
+exit_tx:
+    tx_close();
     close(epoll_fd);
-    LOG_INFO("The DBus handler thread exited successfully");
+    if (!ret) {
+        LOG_INFO("The DBus handler thread exited successfully");
+    }
 
-    return 0;
+    return ret;
+}
+
+/* Connect to the bus and subscribe, NULL if the bus is not reachable */
+static DBusConnection *dbus_connect(void)
+{
+    DBusConnection *conn;
+    int32_t ret;
+
+    conn = setup_dbus_connection();
+    if (!conn) {
+        LOG_ERROR("Unable to establish connection with DBus");
+        return NULL;
+    }
+
+    ret = set_dbus_signal_match_rule(conn);
+    if (ret) {
+        LOG_ERROR("DBus add signal match rule Error: %d", ret);
+        close_dbus_connection(conn);
+        return NULL;
+    }
+
+    set_dbus_connection(conn);
+
+    /* Acted on by the listener loop once it can send */
+    peer_on_bus = dbus_bus_name_has_owner(conn, REMOTE_SER_NAME, NULL);
+
+    return conn;
+}
+
+static void dbus_disconnect(DBusConnection *conn)
+{
+    get_ctx()->comm.dbus_conn = NULL;
+    close_dbus_connection(conn);
+}
+
+/* Sleep @ms before reconnecting, cut short by a service event */
+static void reconnect_wait(int32_t ms)
+{
+    struct pollfd pfd = {
+        .fd = get_ctx()->comm.event,
+        .events = POLLIN,
+    };
+
+    if (poll(&pfd, 1, ms) > 0)
+        handle_ctx_event();
 }
 
 /**********************
@@ -474,6 +1208,15 @@ DBusConnection *get_dbus_connection()
     return ctx->comm.dbus_conn;
 }
 
+/*
+ * A peer sending compact frames also sends registered key names, until
+ * then state frames may still use the positional layout.
+ */
+bool dbus_peer_is_compact(void)
+{
+    return atomic_load(&peer_compact);
+}
+
 int32_t set_dbus_connection(DBusConnection *conn)
 {
     ctx_t *ctx = get_ctx();
@@ -511,40 +1254,41 @@ int32_t add_dbus_match_rule(DBusConnection *conn, const char *rule)
  * It keeps the listener running for the entire lifetime of this service
  * to handle DBus communication, including method calls from other services
  * and signal events registered for this service.
+ *
+ * A lost bus connection is opened again, with an exponential backoff from
+ * DBUS_RECONNECT_MIN_MS to DBUS_RECONNECT_MAX_MS between attempts. Calls
+ * sent on the old connection fail with -ENOTCONN.
  */
 void *dbus_fn_thread_handler()
 {
+    int32_t backoff_ms = DBUS_RECONNECT_MIN_MS;
     DBusConnection *conn;
     int32_t ret;
 
-    conn = setup_dbus_connection();
-    if (!conn) {
-        LOG_FATAL("Unable to establish connection with DBus");
-        goto exit_error;
-    }
+    while (get_ctx()->run) {
+        conn = dbus_connect();
+        if (conn) {
+            backoff_ms = DBUS_RECONNECT_MIN_MS;
+
+            // This loop processes DBus messages
+            ret = dbus_listener_loop(conn);
+            dbus_disconnect(conn);
+            if (!ret)
+                break;
 
-    ret = set_dbus_signal_match_rule(conn);
-    if (ret) {
-        LOG_ERROR("DBus add signal match rule Error: %d", ret);
-        goto exit_error;
-    }
+            peer_set_up(false);
+            dbus_req_abort_sent(-ENOTCONN);
+        }
 
-    ret = set_dbus_connection(conn);
-    if (ret) {
-        LOG_FATAL("Unable to save connection with DBus: %d", ret);
-        goto exit_error;
-    }
+        if (!get_ctx()->run)
+            break;
 
-    // This loop processes DBus messages
-    ret = dbus_listener_loop(conn);
-    if (ret) {
-        LOG_FATAL("Failed to create DBus listener");
-        goto exit_error;
+        LOG_WARN("Reconnecting to DBus in %d ms", backoff_ms);
+        reconnect_wait(backoff_ms);
+        backoff_ms = backoff_ms * 2 > DBUS_RECONNECT_MAX_MS ? \
+                     DBUS_RECONNECT_MAX_MS : backoff_ms * 2;
     }
 
-    dbus_connection_unref(conn);
-
-exit_error:
     return NULL;
 }
 
@@ -558,37 +1302,33 @@ exit_error:
  */
 static int32_t dbus_send_message_async(DBusMessage *msg, remote_cmd_t *cmd)
 {
-    DBusConnection *conn;
+    frame_fmt_t fmt;
+    int32_t ret;
 
     if (!msg || !cmd)
         return -EINVAL;
 
-    conn = get_dbus_connection();
-    if (!conn) {
-        LOG_ERROR("Failed to get dbus connection");
-        return -EIO;
-    }
-
-    if (encode_data_frame(msg, cmd)) {
+    fmt = atomic_load(&peer_compact) ? FRAME_FMT_COMPACT : FRAME_FMT_LEGACY;
+    if (encode_data_frame(msg, cmd, fmt) < 0) {
         LOG_ERROR("Failed to encode data frame");
+        dbus_req_abort(cmd->umid, -EIO);
         dbus_message_unref(msg);
         return -EIO;
     }
 
     /*
-     * Sends a method call or signal without waiting for a reply, because the
-     * listener thread will handle the reply message.
+     * The message is only queued here, the listener thread sends it and
+     * handles the reply message. A call issued through dbus_request() is
+     * matched to that reply by its serial.
      */
-    if (!dbus_connection_send(conn, msg, NULL)) {
-        LOG_ERROR("Out of memory while sending message");
+    ret = tx_queue_msg(msg, cmd->umid, cmd->opcode);
+    if (ret) {
+        LOG_ERROR("DBus listener is not running, message dropped");
+        dbus_req_abort(cmd->umid, ret);
         dbus_message_unref(msg);
-        return -ENOMEM;
     }
 
-    dbus_connection_flush(conn);
-    dbus_message_unref(msg);
-
-    return 0;
+    return ret;
 }
 
 /*
@@ -0,0 +1,379 @@
+/**
+ * @file dbus_req.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <dbus/dbus.h>
+
+#include "list.h"
+#include "util.h"
+#include "comm/cmd_payload.h"
+#include "comm/dbus_req.h"
+#include "mem/obj_pool.h"
+#include "sched/workqueue.h"
+#include "sched/wq_stats.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+/* A method call waiting for its reply */
+typedef struct dbus_req {
+    struct list_head node;
+    uint32_t umid;
+    uint32_t serial;                    /* DBus serial, 0 until sent */
+    uint32_t opcode;
+    uint64_t deadline_ns;
+    uint64_t sent_ns;
+    work_handle_t *handle;
+} dbus_req_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/*
+ * Pending requests, in issue order. Only a handful are in flight at once,
+ * lookups walk the list. Requests are completed outside the lock so their
+ * callbacks may issue new requests.
+ */
+static pthread_mutex_t req_lock = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(req_list);
+static int32_t tick_timer;              /* Timeout scan, 0 while idle */
+
+static obj_pool_t req_pool = OBJ_POOL_INITIALIZER("dbus_req", dbus_req_t);
+
+/* Send to reply, per opcode of the request */
+static wq_hist_t rtt_hist[OP_ID_END];
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static dbus_req_t *find_req_by_umid(uint32_t umid)
+{
+    dbus_req_t *req;
+
+    list_for_each_entry(req, &req_list, node) {
+        if (req->umid == umid)
+            return req;
+    }
+
+    return NULL;
+}
+
+static dbus_req_t *find_req_by_serial(uint32_t serial)
+{
+    dbus_req_t *req;
+
+    if (!serial)
+        return NULL;
+
+    list_for_each_entry(req, &req_list, node) {
+        if (req->serial == serial)
+            return req;
+    }
+
+    return NULL;
+}
+
+/* Called with the request already unlinked, without req_lock */
+static void complete_req(dbus_req_t *req, int32_t result)
+{
+    if (!result && req->sent_ns && req->opcode < OP_ID_END)
+        wq_hist_record(&rtt_hist[req->opcode], now_ns() - req->sent_ns);
+
+    LOG_TRACE("Request umid %u opcode %u completed: %d", req->umid, \
+              req->opcode, result);
+
+    work_handle_complete(req->handle, result);
+    obj_pool_free(&req_pool, req);
+}
+
+/* Stop the timeout scan once nothing is pending, called with req_lock */
+static void tick_stop_if_idle(void)
+{
+    if (!tick_timer || !list_empty(&req_list))
+        return;
+
+    cancel_timed_work(tick_timer);
+    tick_timer = 0;
+}
+
+/*
+ * Periodic timer callback, run on the timer thread: expire the requests
+ * past their deadline. It never queues a work.
+ */
+static work_t *req_tick(void *arg __maybe_unused)
+{
+    dbus_req_t *req, *tmp;
+    LIST_HEAD(expired);
+    uint64_t now = now_ns();
+
+    pthread_mutex_lock(&req_lock);
+    list_for_each_entry_safe(req, tmp, &req_list, node) {
+        if (req->deadline_ns <= now) {
+            list_del(&req->node);
+            list_add_tail(&req->node, &expired);
+        }
+    }
+    tick_stop_if_idle();
+    pthread_mutex_unlock(&req_lock);
+
+    list_for_each_entry_safe(req, tmp, &expired, node) {
+        list_del(&req->node);
+        LOG_WARN("Request umid %u opcode %u timed out%s", req->umid, \
+                 req->opcode, req->serial ? "" : " before being sent");
+        complete_req(req, -ETIMEDOUT);
+    }
+
+    return NULL;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * dbus_request - Send @cmd as a method call and follow its reply
+ * @timeout_ms: reply timeout, 0 for DBUS_REQ_TIMEOUT_MS
+ * @cb:         optional, called once with the result
+ * @arg:        passed to @cb
+ *
+ * The command is queued like create_remote_task() and released once sent.
+ * The returned handle completes with 0 on reply, -EREMOTEIO on an error
+ * reply, -EIO if it could not be sent or -ETIMEDOUT. Several requests may
+ * be in flight at once, wait for each with work_wait() and drop it with
+ * work_handle_put().
+ *
+ * Return: the handle, or NULL on failure in which case @cmd is released.
+ */
+work_handle_t *dbus_request(uint8_t priority, remote_cmd_t *cmd, \
+                            uint32_t timeout_ms, work_done_cb_t cb, void *arg)
+{
+    work_handle_t *h;
+    dbus_req_t *req;
+    work_t *work;
+    int32_t ret;
+
+    if (!cmd)
+        return NULL;
+
+    req = obj_pool_zalloc(&req_pool);
+    h = work_handle_create(cb, arg);
+    work = create_work(WORK_TYPE_REMOTE, priority, cmd->duration, \
+                       OP_DBUS_SENT_CMD, cmd);
+    if (!req || !h || !work) {
+        LOG_ERROR("Failed to create request for opcode %d", cmd->opcode);
+        goto err;
+    }
+
+    req->umid = cmd->umid;
+    req->opcode = cmd->opcode;
+    req->handle = h;
+    req->deadline_ns = now_ns() + (uint64_t)(timeout_ms ? timeout_ms : \
+                       DBUS_REQ_TIMEOUT_MS) * NSEC_PER_MSEC;
+
+    pthread_mutex_lock(&req_lock);
+    /* A request that cannot time out could be waited for forever */
+    if (!tick_timer) {
+        ret = queue_periodic_work(get_wq(UI_WQ), req_tick, NULL, \
+                                  DBUS_REQ_TICK_MS);
+        if (ret <= 0) {
+            pthread_mutex_unlock(&req_lock);
+            LOG_ERROR("Failed to arm request timeouts, ret=%d", ret);
+            goto err;
+        }
+        tick_timer = ret;
+    }
+    list_add_tail(&req->node, &req_list);
+    pthread_mutex_unlock(&req_lock);
+
+    push_work(get_wq(UI_WQ), work);
+
+    return h;
+
+err:
+    if (work)
+        delete_work(work);
+    else
+        delete_remote_cmd(cmd);
+    if (h) {
+        work_handle_put(h);
+        work_handle_put(h);
+    }
+    if (req)
+        obj_pool_free(&req_pool, req);
+    return NULL;
+}
+
+/* Complete the request @umid with @result if it is still pending */
+void dbus_req_abort(uint32_t umid, int32_t result)
+{
+    dbus_req_t *req;
+
+    pthread_mutex_lock(&req_lock);
+    req = find_req_by_umid(umid);
+    if (req) {
+        list_del(&req->node);
+        tick_stop_if_idle();
+    }
+    pthread_mutex_unlock(&req_lock);
+
+    if (req)
+        complete_req(req, result);
+}
+
+/*
+ * dbus_req_send - Send @msg and bind its serial to the request @umid
+ *
+ * The serial is recorded before the reply can be looked up, so even an
+ * immediate reply finds its request. Messages of untracked commands are
+ * sent as is.
+ *
+ * Return: the result of dbus_connection_send().
+ */
+bool dbus_req_send(DBusConnection *conn, DBusMessage *msg, uint32_t umid)
+{
+    dbus_req_t *req;
+    uint32_t serial = 0;
+    bool sent;
+
+    pthread_mutex_lock(&req_lock);
+    sent = dbus_connection_send(conn, msg, &serial);
+    req = find_req_by_umid(umid);
+    if (req && sent) {
+        req->serial = serial;
+        req->sent_ns = now_ns();
+    }
+    pthread_mutex_unlock(&req_lock);
+
+    if (!sent)
+        dbus_req_abort(umid, -EIO);
+
+    return sent;
+}
+
+/*
+ * dbus_req_reply - Complete the request answered by @reply
+ *
+ * Return: true if @reply matched a pending request.
+ */
+bool dbus_req_reply(DBusMessage *reply)
+{
+    dbus_req_t *req;
+    int32_t result = 0;
+
+    pthread_mutex_lock(&req_lock);
+    req = find_req_by_serial(dbus_message_get_reply_serial(reply));
+    if (req) {
+        list_del(&req->node);
+        tick_stop_if_idle();
+    }
+    pthread_mutex_unlock(&req_lock);
+
+    if (!req)
+        return false;
+
+    if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR) {
+        LOG_WARN("Request umid %u opcode %u failed: %s", req->umid, \
+                 req->opcode, dbus_message_get_error_name(reply));
+        result = -EREMOTEIO;
+    }
+
+    complete_req(req, result);
+    return true;
+}
+
+/*
+ * Complete the requests already sent with @result, their replies are lost
+ * with the connection. Those not sent yet go out on the next one.
+ */
+void dbus_req_abort_sent(int32_t result)
+{
+    dbus_req_t *req, *tmp;
+    LIST_HEAD(sent);
+
+    pthread_mutex_lock(&req_lock);
+    list_for_each_entry_safe(req, tmp, &req_list, node) {
+        if (req->serial) {
+            list_del(&req->node);
+            list_add_tail(&req->node, &sent);
+        }
+    }
+    tick_stop_if_idle();
+    pthread_mutex_unlock(&req_lock);
+
+    list_for_each_entry_safe(req, tmp, &sent, node) {
+        list_del(&req->node);
+        complete_req(req, result);
+    }
+}
+
+/* Complete every pending request with @result, e.g. -ESHUTDOWN */
+void dbus_req_cancel_all(int32_t result)
+{
+    dbus_req_t *req, *tmp;
+    LIST_HEAD(pending);
+
+    pthread_mutex_lock(&req_lock);
+    list_for_each_entry_safe(req, tmp, &req_list, node) {
+        list_del(&req->node);
+        list_add_tail(&req->node, &pending);
+    }
+    tick_stop_if_idle();
+    pthread_mutex_unlock(&req_lock);
+
+    list_for_each_entry_safe(req, tmp, &pending, node) {
+        list_del(&req->node);
+        complete_req(req, result);
+    }
+}
+
+/* Log the round trip time of every opcode requested so far, in us */
+void dbus_req_dump_stats(void)
+{
+    wq_hist_t *h;
+    uint32_t count;
+    int32_t op;
+
+    for (op = 0; op < OP_ID_END; op++) {
+        h = &rtt_hist[op];
+        count = atomic_load(&h->count);
+        if (!count)
+            continue;
+
+        LOG_INFO("Opcode %2d rtt    : n %u, avg %llu, p50 %u, p90 %u, " \
+                 "p99 %u, max %u", op, count, \
+                 atomic_load(&h->sum_us) / count, \
+                 wq_hist_percentile(h, 50), wq_hist_percentile(h, 90), \
+                 wq_hist_percentile(h, 99), atomic_load(&h->max_us));
+    }
+}
@@ -0,0 +1,298 @@
+/**
+ * @file dbus_resync.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+
+#include "util.h"
+#include "comm/cmd_payload.h"
+#include "comm/dbus_req.h"
+#include "comm/dbus_resync.h"
+#include "sched/workqueue.h"
+#include "sched/wq_stats.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void resync_done(int32_t result, void *arg);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/* State the UI mirrors from sys-mgr, requested again once it is back */
+static const uint32_t resync_ops[] = {
+    OP_BACKLIGHT_STATE,
+    OP_WIFI_STATE,
+    OP_WIFI_AP_LIST,
+    OP_IMU_STATE,
+};
+
+/*
+ * A resync is one generation. Replies of an older generation, still in
+ * flight when the link dropped again, are not counted. Requests that
+ * failed are issued again after DBUS_RESYNC_RETRY_MS, the link only
+ * counts as recovered once every state came back.
+ */
+static pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t sync_gen;
+static int32_t sync_pending;
+static uint32_t sync_failed;            /* Bit per resync_ops entry */
+static uint32_t retry_ops;              /* Failed ops waiting for retry */
+static int32_t retry_timer;
+static int32_t nr_retries;
+static uint64_t lost_ns;                /* Link lost, 0 while up */
+
+static uint32_t nr_lost;
+static uint32_t nr_resync;
+static wq_hist_t recovery_hist;         /* Link lost to state resynced */
+
+/**********************
+ *      MACROS
+ **********************/
+/* Request callback argument: the generation and the resync_ops index */
+#define RESYNC_ARG(gen, idx)            (void *)(uintptr_t)((gen) << 8 | (idx))
+#define RESYNC_ARG_GEN(arg)             ((uint32_t)((uintptr_t)(arg) >> 8))
+#define RESYNC_ARG_IDX(arg)             ((int32_t)((uintptr_t)(arg) & 0xff))
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+/* Stop a pending retry, called without sync_lock held */
+static void resync_retry_cancel(int32_t id)
+{
+    if (id)
+        cancel_timed_work(id);
+}
+
+/* Request every op of @ops for generation @gen, pending count already set */
+static int32_t resync_issue(uint32_t gen, uint32_t ops)
+{
+    work_handle_t *h;
+    remote_cmd_t *cmd;
+    int32_t i, ret = 0;
+
+    for (i = 0; i < ARRAY_SIZE(resync_ops); i++) {
+        if (!(ops & (1U << i)))
+            continue;
+
+        cmd = create_remote_task_data(WORK_PRIO_NORMAL, WORK_DURATION_SHORT, \
+                                      resync_ops[i]);
+        h = cmd ? dbus_request(WORK_PRIO_HIGH, cmd, 0, resync_done, \
+                               RESYNC_ARG(gen, i)) : NULL;
+        if (!h) {
+            LOG_ERROR("Failed to request opcode %u for resync", resync_ops[i]);
+            resync_done(-ENOMEM, RESYNC_ARG(gen, i));
+            if (!ret)
+                ret = -ENOMEM;
+            continue;
+        }
+
+        work_handle_put(h);
+    }
+
+    return ret;
+}
+
+/*
+ * Timer callback, run once per armed retry: issue the failed requests of
+ * the generation again. It never queues a work.
+ */
+static work_t *resync_retry(void *arg)
+{
+    uint32_t gen = (uint32_t)(uintptr_t)arg;
+    uint32_t ops = 0;
+    int32_t id = 0;
+
+    pthread_mutex_lock(&sync_lock);
+    if (gen == sync_gen && retry_timer) {
+        id = retry_timer;
+        retry_timer = 0;
+        ops = retry_ops;
+        retry_ops = 0;
+        sync_pending = __builtin_popcount(ops);
+        sync_failed = 0;
+    }
+    pthread_mutex_unlock(&sync_lock);
+
+    /* One-shot: the timer is periodic only to get a factory callback */
+    resync_retry_cancel(id);
+    if (ops)
+        resync_issue(gen, ops);
+
+    return NULL;
+}
+
+/* Request callback, on the listener or timer thread */
+static void resync_done(int32_t result, void *arg)
+{
+    uint32_t gen = RESYNC_ARG_GEN(arg);
+    int32_t idx = RESYNC_ARG_IDX(arg);
+    uint64_t took_ns = 0;
+    uint32_t failed = 0;
+    int32_t retry = -1, ret;
+    bool last = false;
+
+    pthread_mutex_lock(&sync_lock);
+    if (gen == sync_gen && sync_pending > 0) {
+        if (result)
+            sync_failed |= 1U << idx;
+
+        last = !--sync_pending;
+        if (last && sync_failed) {
+            failed = sync_failed;
+            if (nr_retries < DBUS_RESYNC_MAX_RETRIES) {
+                retry = ++nr_retries;
+                retry_ops = failed;
+            } else {
+                lost_ns = 0;
+            }
+        } else if (last) {
+            if (lost_ns)
+                took_ns = now_ns() - lost_ns;
+            lost_ns = 0;
+        }
+    }
+    pthread_mutex_unlock(&sync_lock);
+
+    if (!last)
+        return;
+
+    if (retry > 0) {
+        LOG_WARN("Peer state resync, %d of %d requests failed, retry %d", \
+                 __builtin_popcount(failed), ARRAY_SIZE(resync_ops), retry);
+
+        ret = queue_periodic_work(get_wq(UI_WQ), resync_retry, \
+                                  (void *)(uintptr_t)gen, \
+                                  DBUS_RESYNC_RETRY_MS);
+        pthread_mutex_lock(&sync_lock);
+        if (ret > 0 && gen == sync_gen) {
+            retry_timer = ret;
+            ret = 0;
+        }
+        pthread_mutex_unlock(&sync_lock);
+
+        /* Superseded by a new generation meanwhile */
+        if (ret > 0)
+            resync_retry_cancel(ret);
+        else if (ret < 0)
+            LOG_ERROR("Failed to arm resync retry, ret=%d", ret);
+        return;
+    }
+
+    if (took_ns)
+        wq_hist_record(&recovery_hist, took_ns);
+
+    if (failed) {
+        LOG_ERROR("Peer state resync gave up, %d of %d requests failed", \
+                  __builtin_popcount(failed), ARRAY_SIZE(resync_ops));
+    } else if (took_ns) {
+        LOG_INFO("Peer state resynced, %llu ms after the link was lost", \
+                 (unsigned long long)(took_ns / NSEC_PER_MSEC));
+    } else {
+        LOG_INFO("Peer state resynced");
+    }
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * Start the recovery time of the link, either the bus connection or
+ * sys-mgr dropped. Only the first loss counts until the next resync.
+ */
+void dbus_resync_link_lost(void)
+{
+    int32_t id;
+
+    pthread_mutex_lock(&sync_lock);
+    if (!lost_ns) {
+        lost_ns = now_ns();
+        nr_lost++;
+    }
+    /* Whatever was still resyncing belongs to the old link */
+    sync_gen++;
+    sync_pending = 0;
+    retry_ops = 0;
+    id = retry_timer;
+    retry_timer = 0;
+    pthread_mutex_unlock(&sync_lock);
+
+    resync_retry_cancel(id);
+}
+
+/*
+ * dbus_resync_start - Request all mirrored state from sys-mgr at once
+ *
+ * Called once sys-mgr is reachable again, with the outgoing queue open.
+ * Every request is issued in the same burst rather than when the user
+ * opens the matching window. The data comes back as regular commands,
+ * failed requests are retried up to DBUS_RESYNC_MAX_RETRIES times and the
+ * link counts as recovered once all of them are answered.
+ *
+ * Return: 0, or the first error met while issuing the requests.
+ */
+int32_t dbus_resync_start(void)
+{
+    uint32_t gen;
+    int32_t id;
+
+    pthread_mutex_lock(&sync_lock);
+    gen = ++sync_gen;
+    sync_pending = ARRAY_SIZE(resync_ops);
+    sync_failed = 0;
+    retry_ops = 0;
+    nr_retries = 0;
+    id = retry_timer;
+    retry_timer = 0;
+    nr_resync++;
+    pthread_mutex_unlock(&sync_lock);
+
+    resync_retry_cancel(id);
+
+    LOG_INFO("Peer is back, resyncing %d states", ARRAY_SIZE(resync_ops));
+
+    return resync_issue(gen, (1U << ARRAY_SIZE(resync_ops)) - 1);
+}
+
+/* Log the link losses and how long the recovery took, in ms */
+void dbus_resync_dump_stats(void)
+{
+    uint32_t count = atomic_load(&recovery_hist.count);
+
+    LOG_INFO("Peer link    : lost %u, resynced %u", nr_lost, nr_resync);
+    if (!count)
+        return;
+
+    LOG_INFO("Peer recovery: n %u, avg %llu, p50 %u, p99 %u, max %u", \
+             count, atomic_load(&recovery_hist.sum_us) / count / 1000, \
+             wq_hist_percentile(&recovery_hist, 50) / 1000, \
+             wq_hist_percentile(&recovery_hist, 99) / 1000, \
+             atomic_load(&recovery_hist.max_us) / 1000);
+}
@@ -0,0 +1,482 @@
+/**
+ * @file frame_codec.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <dbus/dbus.h>
+
+#include "comm/cmd_keys.h"
+#include "comm/cmd_payload.h"
+#include "comm/frame_codec.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static int32_t encode_legacy_frame(DBusMessage *msg, const remote_cmd_t *cmd)
+{
+    DBusMessageIter iter, array_iter, struct_iter, variant_iter;
+    int32_t prio = cmd->prio, duration = cmd->duration;
+
+    dbus_message_iter_init_append(msg, &iter);
+
+    dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &cmd->component_id);
+    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &cmd->umid);
+    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &cmd->opcode);
+    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &prio);
+    dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &duration);
+
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(siiv)", &array_iter);
+
+    for (uint32_t i = 0; i < cmd->entry_count; ++i) {
+        const payload_t *entry = &cmd->entries[i];
+
+        dbus_message_iter_open_container(&array_iter, DBUS_TYPE_STRUCT, NULL, &struct_iter);
+
+        dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &entry->key);
+        dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT32, &entry->data_type);
+        dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT32, &entry->data_length);
+
+        const char *sig = NULL;
+        switch (entry->data_type) {
+            case DBUS_TYPE_STRING: sig = "s"; break;
+            case DBUS_TYPE_INT32:  sig = "i"; break;
+            case DBUS_TYPE_UINT32: sig = "u"; break;
+            case DBUS_TYPE_DOUBLE: sig = "d"; break;
+            default:
+                LOG_ERROR("Unsupported data_type %d for key '%s'", entry->data_type, entry->key);
+                return -EINVAL;
+        }
+
+        dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_VARIANT, sig, &variant_iter);
+
+        switch (entry->data_type) {
+            case DBUS_TYPE_STRING:
+                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_STRING, &entry->value.str);
+                break;
+            case DBUS_TYPE_INT32:
+                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_INT32, &entry->value.i32);
+                break;
+            case DBUS_TYPE_UINT32:
+                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_UINT32, &entry->value.u32);
+                break;
+            case DBUS_TYPE_DOUBLE:
+                dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_DOUBLE, &entry->value.dbl);
+                break;
+        }
+
+        dbus_message_iter_close_container(&struct_iter, &variant_iter);
+        dbus_message_iter_close_container(&array_iter, &struct_iter);
+    }
+
+    dbus_message_iter_close_container(&iter, &array_iter);
+    return 0;
+}
+
+static int32_t decode_legacy_frame(DBusMessage *msg, remote_cmd_t *out)
+{
+    DBusMessageIter iter, array_iter, struct_iter, variant_iter;
+    int32_t prio, duration, ret;
+
+    if (!dbus_message_iter_init(msg, &iter)) {
+        LOG_ERROR("Failed to init DBus iterator");
+        return -EINVAL;
+    }
+
+    dbus_message_iter_get_basic(&iter, &out->component_id);
+    dbus_message_iter_next(&iter);
+
+    dbus_message_iter_get_basic(&iter, &out->umid);
+    dbus_message_iter_next(&iter);
+
+    dbus_message_iter_get_basic(&iter, &out->opcode);
+    dbus_message_iter_next(&iter);
+
+    /* Sent as INT32, stored as bytes */
+    dbus_message_iter_get_basic(&iter, &prio);
+    out->prio = (uint8_t)prio;
+    dbus_message_iter_next(&iter);
+
+    dbus_message_iter_get_basic(&iter, &duration);
+    out->duration = (uint8_t)duration;
+    dbus_message_iter_next(&iter);
+
+    ret = remote_cmd_reserve(out, dbus_message_iter_get_element_count(&iter));
+    if (ret)
+        return ret;
+
+    dbus_message_iter_recurse(&iter, &array_iter);
+
+    uint32_t i = 0;
+    while (dbus_message_iter_get_arg_type(&array_iter) == DBUS_TYPE_STRUCT && \
+           i < out->entry_cap) {
+        payload_t *entry = &out->entries[i];
+        dbus_message_iter_recurse(&array_iter, &struct_iter);
+
+        dbus_message_iter_get_basic(&struct_iter, &entry->key);
+        entry->key_id = KEY_NONE;
+        dbus_message_iter_next(&struct_iter);
+
+        dbus_message_iter_get_basic(&struct_iter, &entry->data_type);
+        dbus_message_iter_next(&struct_iter);
+
+        dbus_message_iter_get_basic(&struct_iter, &entry->data_length);
+        dbus_message_iter_next(&struct_iter);
+
+        dbus_message_iter_recurse(&struct_iter, &variant_iter);
+
+        switch (entry->data_type) {
+            case DBUS_TYPE_STRING:
+                dbus_message_iter_get_basic(&variant_iter, &entry->value.str);
+                break;
+            case DBUS_TYPE_INT32:
+                dbus_message_iter_get_basic(&variant_iter, &entry->value.i32);
+                break;
+            case DBUS_TYPE_UINT32:
+                dbus_message_iter_get_basic(&variant_iter, &entry->value.u32);
+                break;
+            case DBUS_TYPE_DOUBLE:
+                dbus_message_iter_get_basic(&variant_iter, &entry->value.dbl);
+                break;
+            default:
+                LOG_WARN("Unsupported type %d for entry %d", entry->data_type, i);
+                break;
+        }
+
+        dbus_message_iter_next(&array_iter);
+        i++;
+    }
+
+    out->entry_count = i;
+    return 0;
+}
+
+/* Bytes taken by the value of @entry in a compact frame, or -EINVAL */
+static int32_t compact_value_len(const payload_t *entry)
+{
+    switch (entry->data_type) {
+    case DBUS_TYPE_STRING:
+        return entry->value.str ? (int32_t)strlen(entry->value.str) + 1 : 1;
+    case DBUS_TYPE_INT32:
+    case DBUS_TYPE_UINT32:
+        return sizeof(uint32_t);
+    case DBUS_TYPE_DOUBLE:
+        return sizeof(double);
+    default:
+        return -EINVAL;
+    }
+}
+
+/*
+ * Pack @cmd into @buf.
+ *
+ * Return: the frame length, -EMSGSIZE if it does not fit in @size, or
+ * -EINVAL on an unsupported entry.
+ */
+static int32_t pack_compact_frame(const remote_cmd_t *cmd, uint8_t *buf, \
+                                  int32_t size)
+{
+    const char *comp = cmd->component_id ? cmd->component_id : "";
+    frame_entry_hdr_t ehdr;
+    frame_hdr_t hdr;
+    const void *val;
+    int32_t pos, key_len, val_len;
+    uint32_t i;
+
+    hdr.magic = FRAME_COMPACT_MAGIC;
+    hdr.version = FRAME_COMPACT_VERSION;
+    hdr.prio = cmd->prio;
+    hdr.duration = cmd->duration;
+    hdr.reserved = 0;
+    hdr.umid = cmd->umid;
+    hdr.opcode = cmd->opcode;
+    hdr.entry_count = cmd->entry_count;
+    hdr.comp_len = strlen(comp) + 1;
+
+    pos = sizeof(hdr) + hdr.comp_len;
+    if (pos > size)
+        return -EMSGSIZE;
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), comp, hdr.comp_len);
+
+    for (i = 0; i < cmd->entry_count; i++) {
+        const payload_t *entry = &cmd->entries[i];
+
+        val_len = compact_value_len(entry);
+        if (val_len < 0) {
+            LOG_ERROR("Unsupported data_type %d for key '%s'", \
+                      entry->data_type, entry->key);
+            return -EINVAL;
+        }
+
+        key_len = entry->key_id != KEY_NONE ? 0 : strlen(entry->key) + 1;
+        if (key_len > UINT8_MAX || val_len > UINT16_MAX)
+            return -EMSGSIZE;
+        if (pos + (int32_t)sizeof(ehdr) + key_len + val_len > size)
+            return -EMSGSIZE;
+
+        ehdr.data_type = entry->data_type;
+        ehdr.key_id = entry->key_id;
+        ehdr.key_len = key_len;
+        ehdr.reserved = 0;
+        ehdr.val_len = val_len;
+        memcpy(buf + pos, &ehdr, sizeof(ehdr));
+        pos += sizeof(ehdr);
+
+        memcpy(buf + pos, entry->key, key_len);
+        pos += key_len;
+
+        if (entry->data_type == DBUS_TYPE_STRING)
+            val = entry->value.str ? entry->value.str : "";
+        else
+            val = &entry->value;
+        memcpy(buf + pos, val, val_len);
+        pos += val_len;
+    }
+
+    return pos;
+}
+
+static int32_t encode_compact_frame(DBusMessage *msg, const remote_cmd_t *cmd)
+{
+    uint8_t buf[FRAME_COMPACT_MAX];
+    const uint8_t *data = buf;
+    DBusMessageIter iter, array_iter;
+    int32_t len;
+
+    len = pack_compact_frame(cmd, buf, sizeof(buf));
+    if (len < 0)
+        return len;
+
+    /* One copy of the whole table instead of a container per entry */
+    dbus_message_iter_init_append(msg, &iter);
+    if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, \
+                                          DBUS_TYPE_BYTE_AS_STRING, \
+                                          &array_iter))
+        return -ENOMEM;
+
+    if (!dbus_message_iter_append_fixed_array(&array_iter, DBUS_TYPE_BYTE, \
+                                              &data, len)) {
+        dbus_message_iter_abandon_container(&iter, &array_iter);
+        return -ENOMEM;
+    }
+
+    if (!dbus_message_iter_close_container(&iter, &array_iter))
+        return -ENOMEM;
+
+    return 0;
+}
+
+/*
+ * Unpack a compact frame. Strings point into @buf, nothing is copied.
+ */
+static int32_t unpack_compact_frame(const uint8_t *buf, int32_t len, \
+                                    remote_cmd_t *out)
+{
+    frame_entry_hdr_t ehdr;
+    frame_hdr_t hdr;
+    const char *key, *val;
+    int32_t i, pos, ret;
+
+    if (len < (int32_t)sizeof(hdr))
+        return -EINVAL;
+
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != FRAME_COMPACT_MAGIC || \
+        hdr.version != FRAME_COMPACT_VERSION) {
+        LOG_ERROR("Unknown compact frame 0x%08x version %d", \
+                  hdr.magic, hdr.version);
+        return -EPROTO;
+    }
+
+    pos = sizeof(hdr);
+    if (!hdr.comp_len || pos + hdr.comp_len > len || \
+        buf[pos + hdr.comp_len - 1] != '\0')
+        return -EINVAL;
+
+    out->component_id = (const char *)buf + pos;
+    out->umid = hdr.umid;
+    out->opcode = hdr.opcode;
+    out->prio = hdr.prio;
+    out->duration = hdr.duration;
+    pos += hdr.comp_len;
+
+    ret = remote_cmd_reserve(out, hdr.entry_count);
+    if (ret)
+        return ret;
+
+    for (i = 0; i < hdr.entry_count; i++) {
+        payload_t *entry = &out->entries[i];
+
+        if (pos + (int32_t)sizeof(ehdr) > len)
+            return -EINVAL;
+        memcpy(&ehdr, buf + pos, sizeof(ehdr));
+        pos += sizeof(ehdr);
+
+        if (pos + ehdr.key_len + ehdr.val_len > len)
+            return -EINVAL;
+
+        key = (const char *)buf + pos;
+        val = key + ehdr.key_len;
+        if (ehdr.key_len) {
+            if (key[ehdr.key_len - 1] != '\0')
+                return -EINVAL;
+            entry->key = key;
+            entry->key_id = KEY_NONE;
+        } else if (ehdr.key_id > KEY_NONE && ehdr.key_id < NR_CMD_KEYS) {
+            entry->key = cmd_key_name(ehdr.key_id);
+            entry->key_id = ehdr.key_id;
+        } else {
+            /* Key registered by a newer peer, keep the value unnamed */
+            LOG_WARN("Unknown key id %d for entry %d", ehdr.key_id, i);
+            entry->key = "";
+            entry->key_id = KEY_NONE;
+        }
+
+        entry->data_type = ehdr.data_type;
+        entry->data_length = ehdr.val_len;
+
+        switch (ehdr.data_type) {
+        case DBUS_TYPE_STRING:
+            if (!ehdr.val_len || val[ehdr.val_len - 1] != '\0')
+                return -EINVAL;
+            entry->value.str = val;
+            break;
+        case DBUS_TYPE_INT32:
+        case DBUS_TYPE_UINT32:
+            if (ehdr.val_len != sizeof(uint32_t))
+                return -EINVAL;
+            memcpy(&entry->value.u32, val, sizeof(uint32_t));
+            break;
+        case DBUS_TYPE_DOUBLE:
+            if (ehdr.val_len != sizeof(double))
+                return -EINVAL;
+            memcpy(&entry->value.dbl, val, sizeof(double));
+            break;
+        default:
+            LOG_WARN("Unsupported type %d for entry %d", ehdr.data_type, i);
+            break;
+        }
+
+        pos += ehdr.key_len + ehdr.val_len;
+    }
+
+    out->entry_count = i;
+    return 0;
+}
+
+static int32_t decode_compact_frame(DBusMessage *msg, remote_cmd_t *out)
+{
+    DBusMessageIter iter, array_iter;
+    const uint8_t *data;
+    int32_t len;
+
+    if (!dbus_message_iter_init(msg, &iter))
+        return -EINVAL;
+
+    dbus_message_iter_recurse(&iter, &array_iter);
+    dbus_message_iter_get_fixed_array(&array_iter, &data, &len);
+
+    return unpack_compact_frame(data, len, out);
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * encode_data_frame - Append @cmd to @msg in format @fmt
+ *
+ * A command too large for a compact frame is sent as a legacy frame.
+ *
+ * Return: the format used, or a negative errno.
+ */
+int32_t encode_data_frame(DBusMessage *msg, const remote_cmd_t *cmd, \
+                          frame_fmt_t fmt)
+{
+    int32_t ret;
+
+    if (!msg || !cmd)
+        return -EINVAL;
+
+    if (fmt == FRAME_FMT_COMPACT) {
+        ret = encode_compact_frame(msg, cmd);
+        if (ret != -EMSGSIZE)
+            return ret ? ret : FRAME_FMT_COMPACT;
+
+        LOG_DEBUG("Opcode %d too large for a compact frame", cmd->opcode);
+    }
+
+    ret = encode_legacy_frame(msg, cmd);
+    return ret ? ret : FRAME_FMT_LEGACY;
+}
+
+/*
+ * decode_data_frame - Decode @msg into @out, whatever its format
+ *
+ * Strings are not copied: component_id, keys and string values point into
+ * @msg, which must outlive @out. See dispatch_cmd_from_message(). Entries
+ * are indexed by key for the remote_cmd_get_*() accessors.
+ *
+ * Return: the format of @msg, or a negative errno.
+ */
+int32_t decode_data_frame(DBusMessage *msg, remote_cmd_t *out)
+{
+    frame_fmt_t fmt = FRAME_FMT_LEGACY;
+    uint32_t i;
+    int32_t ret;
+
+    if (!msg || !out)
+        return -EINVAL;
+
+    if (dbus_message_has_signature(msg, FRAME_COMPACT_SIG)) {
+        fmt = FRAME_FMT_COMPACT;
+        ret = decode_compact_frame(msg, out);
+    } else {
+        ret = decode_legacy_frame(msg, out);
+    }
+
+    if (ret)
+        return ret;
+
+    memset(out->key_slot, 0, sizeof(out->key_slot));
+    for (i = 0; i < out->entry_count; i++)
+        remote_cmd_index_entry(out, i);
+
+    return fmt;
+}
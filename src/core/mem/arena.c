@@ -0,0 +1,137 @@
+/**
+ * @file arena.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "mem/arena.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    uint8_t data[] __attribute__((aligned(ARENA_ALIGN)));
+} arena_chunk_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+#define ARENA_ROUND(n)                  \
+    (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static arena_chunk_t *arena_grow(arena_t *arena, size_t size)
+{
+    bool own = size > ARENA_CHUNK_MIN;
+    arena_chunk_t *chunk;
+
+    chunk = malloc(sizeof(*chunk) + (own ? size : ARENA_CHUNK_MIN));
+    if (!chunk)
+        return NULL;
+
+    chunk->size = own ? size : ARENA_CHUNK_MIN;
+    chunk->used = 0;
+
+    /*
+     * A request larger than a chunk gets a chunk of its own, queued behind
+     * the current one so its free space is still used.
+     */
+    if (own && arena->head) {
+        chunk->next = arena->head->next;
+        arena->head->next = chunk;
+    } else {
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+
+    return chunk;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * arena_alloc - Carve @size bytes out of @arena
+ *
+ * The memory is aligned for any pointer or integer, not zeroed, and lives
+ * until arena_release().
+ *
+ * Return: the memory, or NULL when out of memory.
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    arena_chunk_t *chunk = arena->head;
+    void *ptr;
+
+    size = ARENA_ROUND(size ? size : 1);
+    if (!chunk || chunk->size - chunk->used < size) {
+        chunk = arena_grow(arena, size);
+        if (!chunk) {
+            LOG_ERROR("Arena out of memory, %zu bytes", size);
+            return NULL;
+        }
+    }
+
+    ptr = chunk->data + chunk->used;
+    chunk->used += size;
+
+    return ptr;
+}
+
+char *arena_strdup(arena_t *arena, const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *dup;
+
+    dup = arena_alloc(arena, len);
+    if (dup)
+        memcpy(dup, str, len);
+
+    return dup;
+}
+
+void arena_release(arena_t *arena)
+{
+    arena_chunk_t *chunk, *next;
+
+    for (chunk = arena->head; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+
+    arena->head = NULL;
+}
@@ -0,0 +1,324 @@
+/**
+ * @file obj_pool.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "util.h"
+#include "mem/obj_pool.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define OBJ_ALIGN                       (sizeof(void *) * 2)
+#define CACHE_BATCH                     (OBJ_POOL_CACHE_SIZE / 2)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct obj_slab {
+    struct obj_slab *next;
+    _Alignas(OBJ_ALIGN) uint8_t objs[];
+} obj_slab_t;
+
+typedef struct obj_cache {
+    uint32_t count;
+    void *objs[OBJ_POOL_CACHE_SIZE];
+} obj_cache_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static obj_pool_t *registry[OBJ_POOL_MAX];
+static int32_t nr_registered;
+
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static __thread obj_cache_t thread_cache[OBJ_POOL_MAX];
+static __thread int32_t thread_cache_armed;
+
+/**********************
+ *      MACROS
+ **********************/
+#define ALIGN_UP(x, a)                  (((x) + (a) - 1) & ~((size_t)(a) - 1))
+#define NEXT_FREE(obj)                  (*(void **)(obj))
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+/* Caller holds pool->lock */
+static void free_list_put(obj_pool_t *pool, void **objs, uint32_t nr)
+{
+    uint32_t i;
+
+    for (i = 0; i < nr; i++) {
+        NEXT_FREE(objs[i]) = pool->free_list;
+        pool->free_list = objs[i];
+    }
+}
+
+/* Caller holds pool->lock */
+static int32_t pool_grow(obj_pool_t *pool)
+{
+    size_t stride = ALIGN_UP(pool->obj_size, OBJ_ALIGN);
+    obj_slab_t *slab;
+    int32_t i;
+
+    slab = malloc(sizeof(*slab) + stride * OBJ_POOL_SLAB_OBJS);
+    if (!slab)
+        return -1;
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    for (i = OBJ_POOL_SLAB_OBJS - 1; i >= 0; i--) {
+        NEXT_FREE(slab->objs + i * stride) = pool->free_list;
+        pool->free_list = slab->objs + i * stride;
+    }
+
+    atomic_fetch_add(&pool->nr_slabs, 1);
+    atomic_fetch_add(&pool->nr_objs, OBJ_POOL_SLAB_OBJS);
+
+    LOG_TRACE("Pool %s grown to %u objects", pool->name, \
+              atomic_load(&pool->nr_objs));
+    return 0;
+}
+
+/* Caller holds pool->lock */
+static void *free_list_get(obj_pool_t *pool)
+{
+    void *obj;
+
+    if (!pool->free_list && pool_grow(pool))
+        return NULL;
+
+    obj = pool->free_list;
+    pool->free_list = NEXT_FREE(obj);
+    return obj;
+}
+
+/* Return every object cached by the exiting thread to its pool */
+static void cache_flush_all(void *arg __maybe_unused)
+{
+    obj_cache_t *cache;
+    int32_t i;
+
+    pthread_mutex_lock(&registry_lock);
+    for (i = 0; i < nr_registered; i++) {
+        cache = &thread_cache[i];
+        if (!cache->count)
+            continue;
+
+        pthread_mutex_lock(&registry[i]->lock);
+        free_list_put(registry[i], cache->objs, cache->count);
+        pthread_mutex_unlock(&registry[i]->lock);
+        cache->count = 0;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static void cache_key_create(void)
+{
+    pthread_key_create(&cache_key, cache_flush_all);
+}
+
+/*
+ * Thread caches are plain TLS, the key only exists to get a destructor
+ * called when the thread exits so its cached objects are not lost.
+ */
+static void cache_arm(void)
+{
+    pthread_once(&cache_key_once, cache_key_create);
+    pthread_setspecific(cache_key, &thread_cache_armed);
+    thread_cache_armed = 1;
+}
+
+static int32_t pool_register(obj_pool_t *pool)
+{
+    int32_t id;
+
+    pthread_mutex_lock(&registry_lock);
+    id = atomic_load(&pool->id);
+    if (id < 0) {
+        if (nr_registered < OBJ_POOL_MAX) {
+            id = nr_registered;
+            registry[nr_registered++] = pool;
+        } else {
+            LOG_WARN("Pool %s has no thread cache, registry is full", \
+                     pool->name);
+            id = OBJ_POOL_MAX;
+        }
+        atomic_store(&pool->id, id);
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    return id;
+}
+
+static obj_cache_t *get_cache(obj_pool_t *pool)
+{
+    int32_t id = atomic_load_explicit(&pool->id, memory_order_acquire);
+
+    if (id < 0)
+        id = pool_register(pool);
+    if (id >= OBJ_POOL_MAX)
+        return NULL;
+
+    if (!thread_cache_armed)
+        cache_arm();
+
+    return &thread_cache[id];
+}
+
+static void account_alloc(obj_pool_t *pool)
+{
+    uint32_t used, peak;
+
+    used = atomic_fetch_add(&pool->in_use, 1) + 1;
+    peak = atomic_load(&pool->high_water);
+    while (used > peak && \
+           !atomic_compare_exchange_weak(&pool->high_water, &peak, used))
+        ;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * obj_pool_alloc - Take one object from @pool
+ *
+ * Served from the calling thread cache when possible, otherwise the cache
+ * is refilled with a batch from the shared free list, which grows by one
+ * slab when empty. The content of the object is undefined.
+ *
+ * Return: the object on success, NULL on allocation failure.
+ */
+void *obj_pool_alloc(obj_pool_t *pool)
+{
+    obj_cache_t *cache;
+    void *obj = NULL;
+
+    if (!pool)
+        return NULL;
+
+    cache = get_cache(pool);
+    if (cache && cache->count) {
+        obj = cache->objs[--cache->count];
+        account_alloc(pool);
+        return obj;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    obj = free_list_get(pool);
+    while (obj && cache && cache->count < CACHE_BATCH && pool->free_list) {
+        cache->objs[cache->count++] = pool->free_list;
+        pool->free_list = NEXT_FREE(pool->free_list);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!obj) {
+        LOG_ERROR("Pool %s: out of memory", pool->name);
+        return NULL;
+    }
+
+    account_alloc(pool);
+    return obj;
+}
+
+/* obj_pool_zalloc - Same as obj_pool_alloc but the object is zeroed */
+void *obj_pool_zalloc(obj_pool_t *pool)
+{
+    void *obj;
+
+    obj = obj_pool_alloc(pool);
+    if (obj)
+        memset(obj, 0, pool->obj_size);
+
+    return obj;
+}
+
+/*
+ * obj_pool_free - Give @obj back to @pool
+ *
+ * The object may be freed from any thread, not only the allocating one.
+ * A full thread cache hands half of its objects back to the shared list.
+ */
+void obj_pool_free(obj_pool_t *pool, void *obj)
+{
+    obj_cache_t *cache;
+
+    if (!pool || !obj)
+        return;
+
+    atomic_fetch_sub(&pool->in_use, 1);
+
+    cache = get_cache(pool);
+    if (cache && cache->count < OBJ_POOL_CACHE_SIZE) {
+        cache->objs[cache->count++] = obj;
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    free_list_put(pool, &obj, 1);
+    if (cache) {
+        cache->count -= CACHE_BATCH;
+        free_list_put(pool, &cache->objs[cache->count], CACHE_BATCH);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void obj_pool_get_stats(obj_pool_t *pool, obj_pool_stats_t *stats)
+{
+    if (!pool || !stats)
+        return;
+
+    stats->name = pool->name;
+    stats->obj_size = pool->obj_size;
+    stats->nr_slabs = atomic_load(&pool->nr_slabs);
+    stats->nr_objs = atomic_load(&pool->nr_objs);
+    stats->in_use = atomic_load(&pool->in_use);
+    stats->high_water = atomic_load(&pool->high_water);
+}
+
+/*
+ * Log the usage of every pool allocated from so far. The high-water mark is
+ * the figure to size a pool with: slabs are only added while it grows.
+ */
+void obj_pool_dump_stats(void)
+{
+    obj_pool_stats_t st;
+    int32_t i;
+
+    pthread_mutex_lock(&registry_lock);
+    for (i = 0; i < nr_registered; i++) {
+        obj_pool_get_stats(registry[i], &st);
+        LOG_INFO("Pool %-12s: %4zu B x %4u objs in %3u slabs, " \
+                 "in use %u, high-water %u", st.name, st.obj_size, \
+                 st.nr_objs, st.nr_slabs, st.in_use, st.high_water);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
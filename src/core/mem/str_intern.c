@@ -0,0 +1,223 @@
+/**
+ * @file str_intern.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include "mem/str_intern.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct str_ent {
+    uint32_t hash;
+    uint32_t refs;
+    char str[];
+} str_ent_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/*
+ * Open addressing with linear probing, at most 3/4 full. Strings without
+ * references stay for the next user, a window built again finds its names
+ * here. Once STR_INTERN_IDLE_MAX of them pile up, they are all freed in
+ * one sweep. Only touched by the UI thread, the counters aside.
+ */
+static str_ent_t **slots;
+static uint32_t slot_mask;
+static atomic_uint nr_strs;
+static atomic_uint nr_idle;
+static atomic_size_t nr_bytes;
+
+/**********************
+ *      MACROS
+ **********************/
+#define SLOT_NEXT(i)                    (((i) + 1) & slot_mask)
+#define STR_ENT(str)                    \
+    ((str_ent_t *)((char *)(str) - offsetof(str_ent_t, str)))
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+/* FNV-1a */
+static uint32_t hash_str(const char *str)
+{
+    uint32_t h = 2166136261U;
+
+    while (*str) {
+        h ^= (uint8_t)*str++;
+        h *= 16777619U;
+    }
+
+    return h;
+}
+
+static void slot_insert(str_ent_t **tbl, uint32_t mask, str_ent_t *ent)
+{
+    uint32_t i = ent->hash & mask;
+
+    while (tbl[i])
+        i = (i + 1) & mask;
+
+    tbl[i] = ent;
+}
+
+/* Move the entries kept by @keep_idle into a table of @mask + 1 slots */
+static int32_t rehash(uint32_t mask, bool keep_idle)
+{
+    str_ent_t **tbl;
+    str_ent_t *ent;
+    uint32_t i;
+
+    tbl = calloc(mask + 1, sizeof(*tbl));
+    if (!tbl)
+        return -ENOMEM;
+
+    for (i = 0; slots && i <= slot_mask; i++) {
+        ent = slots[i];
+        if (!ent)
+            continue;
+
+        if (!ent->refs && !keep_idle) {
+            atomic_fetch_sub(&nr_bytes, sizeof(*ent) + strlen(ent->str) + 1);
+            atomic_fetch_sub(&nr_strs, 1);
+            atomic_fetch_sub(&nr_idle, 1);
+            free(ent);
+            continue;
+        }
+
+        slot_insert(tbl, mask, ent);
+    }
+
+    free(slots);
+    slots = tbl;
+    slot_mask = mask;
+    return 0;
+}
+
+static str_ent_t *lookup(const char *str, uint32_t hash)
+{
+    uint32_t i;
+
+    if (!slots)
+        return NULL;
+
+    for (i = hash & slot_mask; slots[i]; i = SLOT_NEXT(i)) {
+        if (slots[i]->hash == hash && !strcmp(slots[i]->str, str))
+            return slots[i];
+    }
+
+    return NULL;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * str_intern - Shared, read-only copy of @str
+ *
+ * Equal strings share one copy, so interned strings compare equal by
+ * pointer. Each call takes a reference, drop it with str_intern_put().
+ *
+ * Return: the copy, NULL on allocation failure.
+ */
+const char *str_intern(const char *str)
+{
+    uint32_t hash, len;
+    str_ent_t *ent;
+
+    if (!str)
+        return NULL;
+
+    hash = hash_str(str);
+    ent = lookup(str, hash);
+    if (ent) {
+        if (!ent->refs++)
+            atomic_fetch_sub(&nr_idle, 1);
+        return ent->str;
+    }
+
+    if ((atomic_load(&nr_strs) + 1) * 4 > (slot_mask + 1) * 3 && \
+        rehash(slots ? slot_mask * 2 + 1 : STR_INTERN_MIN_SLOTS - 1, true))
+        return NULL;
+
+    len = strlen(str);
+    ent = malloc(sizeof(*ent) + len + 1);
+    if (!ent)
+        return NULL;
+
+    ent->hash = hash;
+    ent->refs = 1;
+    memcpy(ent->str, str, len + 1);
+    slot_insert(slots, slot_mask, ent);
+
+    atomic_fetch_add(&nr_strs, 1);
+    atomic_fetch_add(&nr_bytes, sizeof(*ent) + len + 1);
+    return ent->str;
+}
+
+/* Drop a reference taken by str_intern() */
+void str_intern_put(const char *str)
+{
+    str_ent_t *ent;
+
+    if (!str)
+        return;
+
+    ent = STR_ENT(str);
+    if (!ent->refs || --ent->refs)
+        return;
+
+    if (atomic_fetch_add(&nr_idle, 1) + 1 > STR_INTERN_IDLE_MAX) {
+        LOG_DEBUG("Freeing %u idle interned strings", atomic_load(&nr_idle));
+        rehash(slot_mask, false);
+    }
+}
+
+void str_intern_get_stats(str_intern_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    stats->nr_strs = atomic_load(&nr_strs);
+    stats->nr_idle = atomic_load(&nr_idle);
+    stats->bytes = atomic_load(&nr_bytes);
+}
+
+void str_intern_dump_stats(void)
+{
+    str_intern_stats_t st;
+
+    str_intern_get_stats(&st);
+    LOG_INFO("Interned strings: %u (%u idle), %zu B", st.nr_strs, \
+             st.nr_idle, st.bytes);
+}
@@ -84,6 +84,7 @@ int32_t get_center(lv_obj_t *lobj, uint32_t par_w, uint32_t par_h)
     int32_t R; /* distance from old right edge to object's center */
     int32_t B; /* distance from old bottom edge to object's center */
     obj_meta_t *meta;
+    obj_align_t *aln;
 
     meta = lobj ? get_meta(lobj) : NULL;
     if (!meta) {
@@ -92,7 +93,7 @@ int32_t get_center(lv_obj_t *lobj, uint32_t par_w, uint32_t par_h)
     }
 
     scr_rot = get_scr_rotation();
-    old_rot = meta->data.rotation;
+    old_rot = get_meta_rotation(meta);
 
     /* nothing to do if rotation unchanged */
     if (scr_rot == old_rot)
@@ -107,10 +108,11 @@ int32_t get_center(lv_obj_t *lobj, uint32_t par_w, uint32_t par_h)
     }
 
     /* cache old parent geometry and gaps */
-    old_pw = meta->align.par_w;
-    old_ph = meta->align.par_h;
-    L = meta->align.mid_x;
-    T = meta->align.mid_y;
+    aln = get_meta_align(meta);
+    old_pw = aln->par_w;
+    old_ph = aln->par_h;
+    L = aln->mid_x;
+    T = aln->mid_y;
     R = old_pw - L;
     B = old_ph - T;
 
@@ -194,11 +196,11 @@ int32_t get_center(lv_obj_t *lobj, uint32_t par_w, uint32_t par_h)
     }
 
     /* Atomic update of meta position state */
-    meta->align.mid_x = new_x_mid;
-    meta->align.mid_y = new_y_mid;
-    meta->align.par_w = par_w;
-    meta->align.par_h = par_h;
-    meta->data.rotation = scr_rot;
+    aln->mid_x = new_x_mid;
+    aln->mid_y = new_y_mid;
+    aln->par_w = par_w;
+    aln->par_h = par_h;
+    set_meta_rotation(meta, scr_rot);
 
     LOG_TRACE("success new_mid=(%d,%d) new_par=(%d,%d) rot=%d",
               new_x_mid, new_y_mid, par_w, par_h, scr_rot);
@@ -209,17 +211,20 @@ int32_t get_center(lv_obj_t *lobj, uint32_t par_w, uint32_t par_h)
 void set_pos(lv_obj_t *lobj, int32_t x_ofs, int32_t y_ofs)
 {
     obj_meta_t *meta = NULL;
+    obj_size_t *size;
     LV_ASSERT_NULL(lobj);
 
     lv_obj_set_pos(lobj, x_ofs, y_ofs);
 
     meta = get_meta(lobj);
-    if (!meta->size.w)
+    size = get_meta_size(meta);
+    if (!size->w)
         LOG_WARN("Cannot calculate the center x");
-    if (!meta->size.h)
+    if (!size->h)
         LOG_WARN("Cannot calculate the center y");
-    meta->align.mid_x = x_ofs + (meta->size.w / 2);
-    meta->align.mid_y = y_ofs + (meta->size.h / 2);
+    get_meta_align(meta)->mid_x = x_ofs + (size->w / 2);
+    get_meta_align(meta)->mid_y = y_ofs + (size->h / 2);
+    mark_meta_dirty(meta, OBJ_DIRTY_GEOMETRY);
 }
 
 void set_pos_center(lv_obj_t *lobj)
@@ -242,16 +247,18 @@ void set_align(lv_obj_t *lobj, lv_obj_t *base, lv_align_t align, \
                       int32_t x_ofs_px, int32_t y_ofs_px)
 {
     obj_meta_t *meta = NULL;
+    obj_align_t *aln;
     LV_ASSERT_NULL(lobj);
 
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
-    meta->align.value = align;
-    meta->align.base = base;
-    meta->align.x = x_ofs_px;
-    meta->align.y = y_ofs_px;
-    meta->align.scale_x = DIS_SCALE;
-    meta->align.scale_y = DIS_SCALE;
+    aln = get_meta_align(meta);
+    aln->value = align;
+    aln->base = base;
+    aln->x = x_ofs_px;
+    aln->y = y_ofs_px;
+    aln->scale_x = DIS_SCALE;
+    aln->scale_y = DIS_SCALE;
 
     apply_align_meta(lobj);
 }
@@ -260,17 +267,19 @@ void set_align_scale_x(lv_obj_t *lobj, lv_obj_t *base, lv_align_t align, \
                             int32_t x_ofs_pct, int32_t y_ofs_px)
 {
     obj_meta_t *meta = NULL;
+    obj_align_t *aln;
 
     LV_ASSERT_NULL(lobj);
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
+    aln = get_meta_align(meta);
 
-    meta->align.value = align;
-    meta->align.base = base;
-    meta->align.x = x_ofs_pct;
-    meta->align.y = y_ofs_px;
-    meta->align.scale_x = ENA_SCALE;
-    meta->align.scale_y = DIS_SCALE;
+    aln->value = align;
+    aln->base = base;
+    aln->x = x_ofs_pct;
+    aln->y = y_ofs_px;
+    aln->scale_x = ENA_SCALE;
+    aln->scale_y = DIS_SCALE;
 
     apply_align_meta(lobj);
 }
@@ -279,17 +288,19 @@ void set_align_scale_y(lv_obj_t *lobj, lv_obj_t *base, lv_align_t align, \
                             int32_t x_ofs_px, int32_t y_ofs_pct)
 {
     obj_meta_t *meta = NULL;
+    obj_align_t *aln;
 
     LV_ASSERT_NULL(lobj);
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
+    aln = get_meta_align(meta);
 
-    meta->align.value = align;
-    meta->align.base = base;
-    meta->align.x = x_ofs_px;
-    meta->align.y = y_ofs_pct;
-    meta->align.scale_x = DIS_SCALE;
-    meta->align.scale_y = ENA_SCALE;
+    aln->value = align;
+    aln->base = base;
+    aln->x = x_ofs_px;
+    aln->y = y_ofs_pct;
+    aln->scale_x = DIS_SCALE;
+    aln->scale_y = ENA_SCALE;
 
     apply_align_meta(lobj);
 }
@@ -298,17 +309,19 @@ void set_align_scale(lv_obj_t *lobj, lv_obj_t *base, lv_align_t align, \
                              int32_t x_ofs_pct, int32_t y_ofs_pct)
 {
     obj_meta_t *meta = NULL;
+    obj_align_t *aln;
 
     LV_ASSERT_NULL(lobj);
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
+    aln = get_meta_align(meta);
 
-    meta->align.value = align;
-    meta->align.base = base;
-    meta->align.x = x_ofs_pct;
-    meta->align.y = y_ofs_pct;
-    meta->align.scale_x = ENA_SCALE;
-    meta->align.scale_y = ENA_SCALE;
+    aln->value = align;
+    aln->base = base;
+    aln->x = x_ofs_pct;
+    aln->y = y_ofs_pct;
+    aln->scale_x = ENA_SCALE;
+    aln->scale_y = ENA_SCALE;
 
     apply_align_meta(lobj);
 }
@@ -318,22 +331,25 @@ void apply_align_meta(lv_obj_t *lobj)
     int32_t x_ofs_px;
     int32_t y_ofs_px;
     obj_meta_t *meta = NULL;
+    obj_align_t *aln;
 
     LV_ASSERT_NULL(lobj);
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
 
-    if (meta->align.scale_x == ENA_SCALE)
-        x_ofs_px = pct_to_px(get_par_w(lobj), meta->align.x);
+    aln = get_meta_align(meta);
+    if (aln->scale_x == ENA_SCALE)
+        x_ofs_px = pct_to_px(get_par_w(lobj), aln->x);
     else
-        x_ofs_px = meta->align.x;
+        x_ofs_px = aln->x;
 
-    if (meta->align.scale_y == ENA_SCALE)
-        y_ofs_px = pct_to_px(get_par_h(lobj), meta->align.y);
+    if (aln->scale_y == ENA_SCALE)
+        y_ofs_px = pct_to_px(get_par_h(lobj), aln->y);
     else
-        y_ofs_px = meta->align.y;
+        y_ofs_px = aln->y;
 
-    lv_obj_align_to(lobj, meta->align.base, meta->align.value, x_ofs_px, y_ofs_px);
+    lv_obj_align_to(lobj, aln->base, aln->value, x_ofs_px, y_ofs_px);
+    mark_meta_dirty(meta, OBJ_DIRTY_GEOMETRY);
 }
 
 /*
@@ -375,7 +391,7 @@ int32_t rotate_alignment_meta_90(lv_obj_t *lobj)
         [LV_ALIGN_OUT_RIGHT_BOTTOM]  = LV_ALIGN_OUT_BOTTOM_LEFT,
     };
 
-    align = meta->align.value;
+    align = get_meta_align(meta)->value;
 
     if (align < 0 || align >= 21 || align_rot90_map[align] == 0) {
         LOG_ERROR("Invalid alignment (%d) for object %s", align, \
@@ -383,7 +399,7 @@ int32_t rotate_alignment_meta_90(lv_obj_t *lobj)
         return -EIO;
     }
 
-    meta->align.value = align_rot90_map[align];
+    get_meta_align(meta)->value = align_rot90_map[align];
 
     return 0;
 }
@@ -393,19 +409,21 @@ int32_t rotate_alignment_offset_meta_90(lv_obj_t *lobj)
     int32_t tmp_x_aln;
     int32_t tmp_scale_x;
     obj_meta_t *meta;
+    obj_align_t *aln;
 
     meta = lobj ? get_meta(lobj) : NULL;
     if (!meta)
         return -EINVAL;
 
-    tmp_x_aln = meta->align.x;
-    tmp_scale_x = meta->align.scale_x;
+    aln = get_meta_align(meta);
+    tmp_x_aln = aln->x;
+    tmp_scale_x = aln->scale_x;
 
-    meta->align.x = -(meta->align.y);
-    meta->align.scale_x = meta->align.scale_y;
+    aln->x = -(aln->y);
+    aln->scale_x = aln->scale_y;
 
-    meta->align.y = tmp_x_aln;
-    meta->align.scale_y = tmp_scale_x;
+    aln->y = tmp_x_aln;
+    aln->scale_y = tmp_scale_x;
 
     return 0;
 }
@@ -57,6 +57,7 @@ static inline int32_t config_border_side_meta(lv_obj_t *lobj, int32_t value)
         return -EINVAL;
 
     meta->layout.border_side = value;
+    mark_meta_dirty(meta, OBJ_DIRTY_PADDING);
 
     return 0;
 }
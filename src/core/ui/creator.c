@@ -97,8 +97,8 @@ static lv_obj_t *create_meta(lv_obj_t *par, int32_t type, \
         goto out_err;
     }
 
-    meta->data.rotation = ROTATION_0;
-    meta->align.value = LV_ALIGN_DEFAULT;
+    set_meta_rotation(meta, ROTATION_0);
+    get_meta_align(meta)->value = LV_ALIGN_DEFAULT;
     // Each child object will have a level increased by one from its parent
     meta->theme.level = get_meta(par)->theme.level + 1;
     ret = set_obj_type(lobj, type);
@@ -326,7 +326,7 @@ int32_t redraw_slider_layout(lv_obj_t *lobj)
     if (!meta)
         return -EINVAL;
 
-    cur_rot = meta->data.rotation;
+    cur_rot = get_meta_rotation(meta);
     scr_rot = get_scr_rotation();
 
     if (((scr_rot == ROTATION_0 || scr_rot == ROTATION_270) &&
@@ -58,7 +58,7 @@ static bool is_rotation_same_group(lv_obj_t *lobj)
     if (!meta)
         return false;
 
-    cur_rot = meta->data.rotation;
+    cur_rot = get_meta_rotation(meta);
     scr_rot = get_scr_rotation();
 
     bool cur_positive = (cur_rot == ROTATION_0 || cur_rot == ROTATION_270);
@@ -134,6 +134,7 @@ int32_t config_flex_layout_align(lv_obj_t *lobj, lv_flex_align_t main_place, \
     conf->main_place = main_place;
     conf->cross_place = cross_place;
     conf->track_place = track_cross_place;
+    mark_obj_dirty(lobj, OBJ_DIRTY_LAYOUT);
 
     return 0;
 }
@@ -226,6 +227,7 @@ int32_t config_flex_layout_flow(lv_obj_t *lobj, lv_flex_flow_t flow)
         return -EINVAL;
 
     conf->flow = flow;
+    mark_obj_dirty(lobj, OBJ_DIRTY_LAYOUT);
 
     return 0;
 }
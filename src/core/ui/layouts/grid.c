@@ -486,6 +486,7 @@ int32_t config_grid_cell_align(lv_obj_t *lobj, lv_grid_align_t col_align, \
     conf->row.max = row_max;
     conf->row.span = row_span;
     conf->row.align = row_align;
+    mark_obj_dirty(lobj, OBJ_DIRTY_LAYOUT);
 
     return 0;
 }
@@ -626,6 +627,7 @@ int32_t append_grid_layout_dsc(lv_obj_t *lobj, grid_desc_t *dsc, \
         return -EINVAL;
 
     scr_rot = get_scr_rotation();
+    mark_obj_dirty(lobj, OBJ_DIRTY_LAYOUT);
 
     if (is_append_direction(scr_rot, type))
         return append_normal_dsc(lobj, dsc, value);
@@ -702,6 +704,7 @@ int32_t remove_grid_layout_last_row_dsc(lv_obj_t *lobj)
     ret = delete_latest_grid_dsc(lobj, dsc, REMOVE_ROW);
     if (ret)
         return ret;
+    mark_obj_dirty(lobj, OBJ_DIRTY_LAYOUT);
 
     ret = refresh_grid_layout_cells_position(lobj, REMOVE_ROW);
     if (ret)
@@ -725,6 +728,7 @@ int32_t remove_grid_layout_last_column_dsc(lv_obj_t *lobj)
     ret = delete_latest_grid_dsc(lobj, dsc, REMOVE_COLUMN);
     if (ret)
         return ret;
+    mark_obj_dirty(lobj, OBJ_DIRTY_LAYOUT);
 
     ret = refresh_grid_layout_cells_position(lobj, REMOVE_COLUMN);
     if (ret)
@@ -815,6 +819,7 @@ int32_t config_grid_layout_align(lv_obj_t *lobj, \
 
     *r_align = row_align;
     *c_align = col_align;
+    mark_obj_dirty(lobj, OBJ_DIRTY_LAYOUT);
 
     return 0;
 }
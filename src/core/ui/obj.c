@@ -20,12 +20,17 @@
 
 #include <lvgl.h>
 #include "list.h"
+#include "mem/obj_pool.h"
+#include "mem/str_intern.h"
 #include "ui/ui_core.h"
+#include "ui/obj_index.h"
+#include "ui/obj_geom.h"
 #include "main.h"
 
 /*********************
  *      DEFINES
  *********************/
+#define ID_NOID                         0
 
 /**********************
  *      TYPEDEFS
@@ -42,6 +47,8 @@
 /**********************
  *  STATIC VARIABLES
  **********************/
+/* Windows are rebuilt often, their metadata is recycled through slabs */
+static obj_pool_t meta_pool = OBJ_POOL_INITIALIZER("obj_meta", obj_meta_t);
 
 /**********************
  *      MACROS
@@ -50,6 +57,107 @@
 /**********************
  *   STATIC FUNCTIONS
  **********************/
+/*
+ * Whether @meta lies under @head_lst: the child list of one of its
+ * ancestors, or the root list (NULL).
+ */
+static bool meta_in_scope(obj_meta_t *meta, struct list_head *head_lst)
+{
+    obj_meta_t *par;
+
+    if (!head_lst || head_lst == &get_ctx()->objs.list)
+        return true;
+
+    for (par = meta->data.par_meta; par; par = par->data.par_meta) {
+        if (&par->child == head_lst)
+            return true;
+    }
+
+    return false;
+}
+
+static obj_meta_t *find_meta_by_id(uint32_t req_id, struct list_head *head_lst)
+{
+    obj_meta_t *meta;
+
+    if (req_id == ID_NOID)
+        return NULL;
+
+    meta = obj_index_find_id(req_id);
+    return (meta && meta_in_scope(meta, head_lst)) ? meta : NULL;
+}
+
+/* First object named @name under @head_lst, in registration order */
+static obj_meta_t *find_meta_by_name(const char *name, \
+                                     struct list_head *head_lst)
+{
+    obj_meta_t *first, *meta;
+
+    first = obj_index_find_name(name);
+    if (!first)
+        return NULL;
+
+    if (meta_in_scope(first, head_lst))
+        return first;
+
+    list_for_each_entry(meta, &first->name_node, name_node) {
+        if (meta_in_scope(meta, head_lst))
+            return meta;
+    }
+
+    return NULL;
+}
+
+static void free_meta(obj_meta_t *meta)
+{
+    LOG_TRACE("DELETE obj ID %d - name %s", meta->id,
+              meta->name ? meta->name : "(null)");
+    obj_index_del(meta);
+    obj_geom_free(meta);
+    list_del(&meta->node);
+    str_intern_put(meta->name);
+    obj_pool_free(&meta_pool, meta);
+}
+
+/*
+ * delete_meta - Delete @meta, its descendants and their LVGL objects
+ *
+ * The meta tree mirrors the LVGL one, so a single lv_obj_delete() on @meta
+ * takes the whole LVGL subtree down. The metadata is then freed in one
+ * post-order pass over the child lists: descend to the first leaf, free
+ * it, climb back to its parent. No recursion, no stack, each node visited
+ * once.
+ *
+ * Return: the number of objects freed.
+ */
+static int32_t delete_meta(obj_meta_t *meta)
+{
+    obj_meta_t *cur = meta, *par;
+    int32_t removed = 0;
+
+    if (lv_obj_is_valid(get_lobj(meta))) {
+        LOG_TRACE("ID %u: deleting LVGL subtree", meta->id);
+        lv_obj_delete(get_lobj(meta));
+    }
+
+    /* The parent has nothing to transform, its flex scroll is reset */
+    mark_meta_dirty(meta->data.par_meta, OBJ_DIRTY_CHILD);
+
+    while (1) {
+        while (!list_empty(&cur->child))
+            cur = list_first_entry(&cur->child, obj_meta_t, node);
+
+        par = cur == meta ? NULL : cur->data.par_meta;
+        free_meta(cur);
+        removed++;
+
+        if (!par)
+            break;
+        cur = par;
+    }
+
+    return removed;
+}
 
 /**********************
  *   GLOBAL FUNCTIONS
@@ -76,14 +184,14 @@ obj_meta_t *register_obj(lv_obj_t *par, lv_obj_t *obj, const char *name)
     if (!obj)
         return NULL;
 
-    meta = calloc(1, sizeof(obj_meta_t));
+    meta = obj_pool_zalloc(&meta_pool);
     if (!meta)
         return NULL;
 
     if (name) {
-        meta->name = strdup(name);
+        meta->name = str_intern(name);
         if (!meta->name) {
-            free(meta);
+            obj_pool_free(&meta_pool, meta);
             return NULL;
         }
     } else {
@@ -91,6 +199,19 @@ obj_meta_t *register_obj(lv_obj_t *par, lv_obj_t *obj, const char *name)
     }
 
     meta->id = obj_ctx->next_id++;
+    if (obj_geom_alloc(meta)) {
+        str_intern_put(meta->name);
+        obj_pool_free(&meta_pool, meta);
+        return NULL;
+    }
+
+    if (obj_index_add(meta)) {
+        obj_geom_free(meta);
+        str_intern_put(meta->name);
+        obj_pool_free(&meta_pool, meta);
+        return NULL;
+    }
+
     meta->obj = obj;
     obj->user_data = meta;
     meta->data.par_meta = (!par) ? NULL : get_meta(par);
@@ -101,6 +222,7 @@ obj_meta_t *register_obj(lv_obj_t *par, lv_obj_t *obj, const char *name)
     parent_list = (!par) ? &obj_ctx->list : &get_meta(par)->child;
 
     list_add_tail(&meta->node, parent_list);
+    mark_meta_dirty(meta, OBJ_DIRTY_SELF);
 
     return meta;
 }
@@ -110,81 +232,25 @@ obj_meta_t *register_obj(lv_obj_t *par, lv_obj_t *obj, const char *name)
  * @req_id:   ID of the object to find
  * @head_lst: Pointer to the list to start scanning (NULL for root list)
  *
- * This function recursively searches for an object with the specified ID in
- * the given list (or the global root list if head_lst is NULL). If found, the
- * function returns the associated lv_obj_t pointer.
+ * This function looks up the object with the specified ID in the object
+ * index, then checks that it lies under the given list (or the global root
+ * list if head_lst is NULL). If found, the function returns the associated
+ * lv_obj_t pointer.
  *
  * Return: Pointer to lv_obj_t if found, NULL otherwise.
  */
 lv_obj_t *get_obj_by_id(uint32_t req_id, struct list_head *head_lst)
 {
-    struct list_head *scan_list;
-    obj_meta_t *meta;
-    lv_obj_t *found = NULL;
-    obj_ctx_t *obj_ctx = &get_ctx()->objs;
-
-    if (head_lst || obj_ctx) {
-        scan_list = head_lst ? head_lst : &obj_ctx->list;
-    } else {
-        return NULL;
-    }
-
-    list_for_each_entry(meta, scan_list, node) {
-        if (!meta->id)
-            continue;
-
-        if (meta->id == req_id)
-            return meta->obj;
-
-        found = get_obj_by_id(req_id, &meta->child);
-        if (found)
-            return found;
-    }
-
-    return NULL;
+    return get_lobj(find_meta_by_id(req_id, head_lst));
 }
 
-/* Find object by name */
+/* Find object by name, the first registered if several match */
 lv_obj_t *get_obj_by_name(const char *name, struct list_head *head_lst)
 {
-    struct list_head *scan_list;
-    obj_meta_t *meta;
-    lv_obj_t *found = NULL;
-    obj_ctx_t *obj_ctx = &get_ctx()->objs;
-
     if (!name)
         return NULL;
 
-    if (head_lst || obj_ctx) {
-        scan_list = head_lst ? head_lst : &obj_ctx->list;
-    } else {
-        return NULL;
-    }
-
-    list_for_each_entry(meta, scan_list, node) {
-        LOG_TRACE("Finding name %s: checking %d %s", name, meta->id, meta->name);
-        if (!meta->id) {
-            LOG_TRACE("Finding name %s: check %d %s: CONTINUE", \
-                      name, meta->id, meta->name);
-            continue;
-        }
-
-        if (meta->name && strcmp(meta->name, name) == 0) {
-
-            LOG_TRACE("Finding name %s: check %d %s: OBJ FOUND", \
-                      name, meta->id, meta->name);
-            return get_lobj(meta);
-        }
-
-        found = get_obj_by_name(name, &meta->child);
-        if (found) {
-            LOG_TRACE("Finding name %s: check list %d %s: OBJ FROM DEEPER LEVEL", \
-                      name, get_meta(found)->id, get_meta(found)->name);
-            return found;
-        }
-    }
-
-    return NULL;
+    return get_lobj(find_meta_by_name(name, head_lst));
 }
 
 /*
@@ -193,7 +259,7 @@ lv_obj_t *get_obj_by_name(const char *name, struct list_head *head_lst)
  * @head_lst: Pointer to the list to start scanning (NULL for root list)
  *
  * This function searches for an object with the given name in the hierarchy.
- * If found, the object and all of its children are deleted recursively.
+ * If found, the object and all of its children are deleted.
  *
  * Return:
  *   0   → object found by name and deleted
@@ -202,37 +268,20 @@ lv_obj_t *get_obj_by_name(const char *name, struct list_head *head_lst)
 int32_t remove_obj_and_child_by_name(const char *name, \
                                         struct list_head *head_lst)
 {
-    struct list_head *scan_list;
     obj_meta_t *meta;
-    obj_ctx_t *obj_ctx = &get_ctx()->objs;
 
     if (!name)
         return -1;
 
-    if (head_lst || obj_ctx) {
-        scan_list = head_lst ? head_lst : &obj_ctx->list;
-    } else {
+    meta = find_meta_by_name(name, head_lst);
+    if (!meta)
         return -1;
-    }
-
-    list_for_each_entry(meta, scan_list, node) {
-        if (!meta->id)
-            continue;
 
-        if (meta->name && strcmp(meta->name, name) == 0) {
-            LOG_TRACE("Removing object by name: %s (ID %u)", name, meta->id);
-            return remove_obj_and_child(meta->id, scan_list);
-        }
-
-        int32_t ret = remove_obj_and_child_by_name(name, &meta->child);
-        if (ret == 0)   /* found and deleted by name */
-            return 0;
-    }
-
-    return -1;
+    LOG_TRACE("Removing object by name: %s (ID %u)", name, meta->id);
+    delete_meta(meta);
+    return 0;
 }
 
-#define ID_NOID                         0
 /*
  * remove_obj_and_child - Remove an object and all its children
  * @req_id:   ID of the object to remove; use ID_NOID to remove all children
@@ -240,8 +289,8 @@ int32_t remove_obj_and_child_by_name(const char *name, \
  *
  * This function searches for an object with the specified ID in the given list
  * (or the global root list if head_lst is NULL). If found, the object and all
- * of its child objects are deleted recursively. When req_id is ID_NOID, all
- * child objects under head_lst are removed.
+ * of its child objects are deleted in a single pass. When req_id is ID_NOID,
+ * all child objects under head_lst are removed, one subtree at a time.
  *
  * Return:
  *   - If req_id is a specific ID:
@@ -269,52 +318,25 @@ int32_t remove_obj_and_child(uint32_t req_id, struct list_head *head_lst)
     LOG_TRACE("Removing object%s",
               head_lst ? " (scan from parent)" : " (scan from root)");
 
-    list_for_each_entry_safe(meta, tmp, scan_list, node) {
-        if (!meta->id)
-            continue;
-
-        if (meta->id == req_id || req_id == ID_NOID) {
-            if (meta->id == req_id)
-                LOG_TRACE("ID %u: found, deleting...", meta->id);
-
-            /* Remove all children first */
-            int32_t child_removed = remove_obj_and_child(ID_NOID, &meta->child);
-            if (child_removed > 0)
-                removed += child_removed;
-
-            if (lv_obj_is_valid(get_lobj(meta))) {
-                LOG_TRACE("ID %u: deleting LVGL object", meta->id);
-                lv_obj_delete(get_lobj(meta));
-            }
-
-            LOG_TRACE("DELETE obj ID %d - name %s", meta->id,
-                      meta->name ? meta->name : "(null)");
-            list_del(&meta->node);
-            if (meta->name)
-                free(meta->name);
-            free(meta);
+    if (req_id != ID_NOID) {
+        meta = find_meta_by_id(req_id, scan_list);
+        if (!meta)
+            return -1;      /* Specific ID not found */
 
-            removed++;
-
-            if (req_id != ID_NOID) {
-                LOG_TRACE("ID %u: object and children deleted", req_id);
-                return 0;   /* Specific ID → report success */
-            }
+        LOG_TRACE("ID %u: found, deleting...", meta->id);
+        delete_meta(meta);
+        LOG_TRACE("ID %u: object and children deleted", req_id);
+        return 0;           /* Specific ID → report success */
+    }
 
+    list_for_each_entry_safe(meta, tmp, scan_list, node) {
+        if (!meta->id)
             continue;
-        }
 
-        /* Recursive search in children */
-        int32_t ret = remove_obj_and_child(req_id, &meta->child);
-        if (req_id != ID_NOID && ret == 0)
-            return 0;       /* Found and deleted by ID */
-        if (req_id == ID_NOID && ret > 0)
-            removed += ret;
+        removed += delete_meta(meta);
     }
 
-    if (req_id == ID_NOID)
-        return removed; /* Return total number of objects removed */
-    return -1;          /* Specific ID not found */
+    return removed;         /* Return total number of objects removed */
 }
 
 /*
@@ -339,6 +361,56 @@ int32_t remove_children(lv_obj_t *par)
     return remove_obj_and_child(ID_NOID, &par_meta->child);
 }
 
+/*
+ * Pre-order walk of @meta and its descendants, same shape as delete_meta()
+ * but the tree is kept: after a node, go to its first child, else to the
+ * next sibling of the closest ancestor that has one.
+ */
+static void add_footprint(obj_meta_t *meta, obj_footprint_t *fp)
+{
+    obj_meta_t *cur = meta;
+
+    while (cur) {
+        fp->nr_objs++;
+        fp->meta_bytes += sizeof(*cur) + OBJ_GEOM_SLOT_BYTES;
+        if (cur->name) {
+            fp->nr_named++;
+            fp->name_bytes += strlen(cur->name) + 1;
+        }
+
+        if (!list_empty(&cur->child)) {
+            cur = list_first_entry(&cur->child, obj_meta_t, node);
+            continue;
+        }
+
+        while (cur != meta && \
+               cur->node.next == &cur->data.par_meta->child)
+            cur = cur->data.par_meta;
+
+        cur = cur == meta ? NULL : list_next_entry(cur, node);
+    }
+}
+
+/*
+ * get_obj_footprint - Measure the metadata of @lobj and its descendants
+ * @fp: filled with the object count and bytes used
+ *
+ * The LVGL objects themselves are not accounted.
+ *
+ * Return: 0 on success, -EINVAL if @lobj is not registered.
+ */
+int32_t get_obj_footprint(lv_obj_t *lobj, obj_footprint_t *fp)
+{
+    obj_meta_t *meta = lobj ? get_meta(lobj) : NULL;
+
+    if (!meta || !fp)
+        return -EINVAL;
+
+    memset(fp, 0, sizeof(*fp));
+    add_footprint(meta, fp);
+    return 0;
+}
+
 /**
  * init_ui_object_list - Allocate and initialize the global ui object list 
  */
@@ -365,6 +437,8 @@ void destroy_ui_object_ctx(ctx_t *ctx)
         return;
 
     remove_obj_and_child(ID_NOID, &ctx->objs.list);
+    obj_index_reset();
+    obj_geom_reset();
     ctx->objs.next_id = 1;
 }
 
@@ -0,0 +1,211 @@
+/**
+ * @file obj_geom.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "ui/ui_core.h"
+#include "ui/obj_geom.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+/*
+ * Slots are handed out in registration order and never reused in place.
+ * Freed slots at the end are given back at once, the others are squeezed
+ * out by compact() once they make up half of the table, so the geometry of
+ * a subtree stays in consecutive slots, in the order it was built.
+ */
+obj_geom_t obj_geom;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+#define GEOM_REALLOC(arr, nr)           \
+    ({ \
+        void *__p = realloc(obj_geom.arr, (nr) * sizeof(*obj_geom.arr)); \
+        if (__p) \
+            obj_geom.arr = __p; \
+        __p; \
+    })
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static int32_t geom_grow(void)
+{
+    uint32_t nr = obj_geom.nr_slots ? obj_geom.nr_slots * 2 : \
+                  OBJ_GEOM_MIN_SLOTS;
+
+    /* An array grown alone is only larger than needed, nothing to undo */
+    if (!GEOM_REALLOC(size, nr) || !GEOM_REALLOC(align, nr) || \
+        !GEOM_REALLOC(pad, nr) || !GEOM_REALLOC(rotation, nr) || \
+        !GEOM_REALLOC(dirty, nr) || !GEOM_REALLOC(owner, nr))
+        return -ENOMEM;
+
+    obj_geom.nr_slots = nr;
+    return 0;
+}
+
+static void geom_move(uint32_t to, uint32_t from)
+{
+    obj_geom.size[to] = obj_geom.size[from];
+    obj_geom.align[to] = obj_geom.align[from];
+    obj_geom.pad[to] = obj_geom.pad[from];
+    obj_geom.rotation[to] = obj_geom.rotation[from];
+    obj_geom.dirty[to] = obj_geom.dirty[from];
+    obj_geom.owner[to] = obj_geom.owner[from];
+    obj_geom.owner[to]->geom = to;
+}
+
+/* Move the used slots down over the free ones, keeping their order */
+static void geom_compact(void)
+{
+    uint32_t i, to = 0;
+
+    for (i = 0; i < obj_geom.nr_used; i++) {
+        if (!obj_geom.owner[i])
+            continue;
+
+        if (i != to)
+            geom_move(to, i);
+        to++;
+    }
+
+    LOG_TRACE("Geometry table compacted, %u -> %u slots", \
+              obj_geom.nr_used, to);
+    obj_geom.nr_used = to;
+    obj_geom.nr_free = 0;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * obj_geom_alloc - Give @meta a zeroed geometry slot
+ *
+ * The table may move, pointers returned by get_meta_size() and friends
+ * must not be kept across a registration.
+ *
+ * Return: 0 on success, -ENOMEM if the table could not grow.
+ */
+int32_t obj_geom_alloc(obj_meta_t *meta)
+{
+    uint32_t i;
+
+    if (obj_geom.nr_used == obj_geom.nr_slots && geom_grow())
+        return -ENOMEM;
+
+    i = obj_geom.nr_used++;
+    memset(&obj_geom.size[i], 0, sizeof(obj_geom.size[i]));
+    memset(&obj_geom.align[i], 0, sizeof(obj_geom.align[i]));
+    memset(&obj_geom.pad[i], 0, sizeof(obj_geom.pad[i]));
+    obj_geom.rotation[i] = ROTATION_0;
+    obj_geom.dirty[i] = 0;
+    obj_geom.owner[i] = meta;
+    meta->geom = i;
+
+    return 0;
+}
+
+/* Release the slot of @meta, before it is freed. Other slots may move. */
+void obj_geom_free(obj_meta_t *meta)
+{
+    uint32_t i = meta->geom;
+
+    if (i >= obj_geom.nr_used || obj_geom.owner[i] != meta)
+        return;
+
+    obj_geom.owner[i] = NULL;
+    obj_geom.nr_free++;
+
+    while (obj_geom.nr_used && !obj_geom.owner[obj_geom.nr_used - 1]) {
+        obj_geom.nr_used--;
+        obj_geom.nr_free--;
+    }
+
+    if (obj_geom.nr_free > OBJ_GEOM_MIN_SLOTS && \
+        obj_geom.nr_free * 2 > obj_geom.nr_used)
+        geom_compact();
+}
+
+/*
+ * mark_meta_dirty - Have the next refresh_object_tree_layout() redo @meta
+ * @flags: OBJ_DIRTY_* reasons
+ *
+ * Ancestors get OBJ_DIRTY_CHILD, so a refresh started from any of them
+ * finds @meta and skips the clean branches. The climb stops at the first
+ * ancestor already flagged, those above it were flagged along with it.
+ */
+void mark_meta_dirty(obj_meta_t *meta, uint8_t flags)
+{
+    obj_meta_t *par;
+
+    if (!meta)
+        return;
+
+    obj_geom.dirty[meta->geom] |= flags;
+
+    for (par = meta->data.par_meta; par; par = par->data.par_meta) {
+        if (obj_geom.dirty[par->geom] & OBJ_DIRTY_CHILD)
+            break;
+        obj_geom.dirty[par->geom] |= OBJ_DIRTY_CHILD;
+    }
+}
+
+void mark_obj_dirty(lv_obj_t *lobj, uint8_t flags)
+{
+    mark_meta_dirty(lobj ? get_meta(lobj) : NULL, flags);
+}
+
+/* Flag every object at once, e.g. when the screen rotation changes */
+void mark_all_dirty(uint8_t flags)
+{
+    uint32_t i;
+
+    for (i = 0; i < obj_geom.nr_used; i++) {
+        if (obj_geom.owner[i])
+            obj_geom.dirty[i] |= flags | OBJ_DIRTY_CHILD;
+    }
+}
+
+/* Forget every slot, once the object tree is gone */
+void obj_geom_reset(void)
+{
+    free(obj_geom.size);
+    free(obj_geom.align);
+    free(obj_geom.pad);
+    free(obj_geom.rotation);
+    free(obj_geom.dirty);
+    free(obj_geom.owner);
+    memset(&obj_geom, 0, sizeof(obj_geom));
+}
@@ -0,0 +1,341 @@
+/**
+ * @file obj_index.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "list.h"
+#include "ui/ui_core.h"
+#include "ui/obj_index.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+/* Objects sharing a name, in registration order through their name_node */
+typedef struct {
+    uint32_t hash;
+    obj_meta_t *first;                  /* NULL for a free slot */
+} name_slot_t;
+
+/*
+ * Open addressing with linear probing. A table is at most 3/4 full, so a
+ * probe always ends on a free slot. Deletion shifts the following entries
+ * back, no tombstones are left.
+ */
+typedef struct {
+    obj_meta_t **id_slots;
+    name_slot_t *name_slots;
+    uint32_t id_mask;
+    uint32_t name_mask;
+    uint32_t nr_ids;
+    uint32_t nr_names;
+} obj_index_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/* Only touched by the UI thread, like the object tree itself */
+static obj_index_t obj_idx;
+
+/**********************
+ *      MACROS
+ **********************/
+#define SLOT_NEXT(i, mask)              (((i) + 1) & (mask))
+#define OVER_LOAD(nr, mask)             (((nr) + 1) * 4 > ((mask) + 1) * 3)
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static uint32_t hash_id(uint32_t id)
+{
+    return id * 2654435761U;
+}
+
+/* FNV-1a */
+static uint32_t hash_name(const char *name)
+{
+    uint32_t h = 2166136261U;
+
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619U;
+    }
+
+    return h;
+}
+
+/* Whether @i lies cyclically in (@from, @to] */
+static bool slot_between(uint32_t from, uint32_t i, uint32_t to)
+{
+    return from <= to ? (from < i && i <= to) : (from < i || i <= to);
+}
+
+/*=====================
+ * Id table
+ *====================*/
+static void id_insert(obj_meta_t **slots, uint32_t mask, obj_meta_t *meta)
+{
+    uint32_t i = hash_id(meta->id) & mask;
+
+    while (slots[i])
+        i = SLOT_NEXT(i, mask);
+
+    slots[i] = meta;
+}
+
+static int32_t id_grow(void)
+{
+    uint32_t i, mask = obj_idx.id_mask ? obj_idx.id_mask * 2 + 1 : \
+                       OBJ_INDEX_MIN_SLOTS - 1;
+    obj_meta_t **slots;
+
+    slots = calloc(mask + 1, sizeof(*slots));
+    if (!slots)
+        return -ENOMEM;
+
+    for (i = 0; obj_idx.id_slots && i <= obj_idx.id_mask; i++) {
+        if (obj_idx.id_slots[i])
+            id_insert(slots, mask, obj_idx.id_slots[i]);
+    }
+
+    free(obj_idx.id_slots);
+    obj_idx.id_slots = slots;
+    obj_idx.id_mask = mask;
+    return 0;
+}
+
+static int32_t id_lookup(uint32_t id)
+{
+    uint32_t i;
+
+    if (!obj_idx.id_slots)
+        return -1;
+
+    for (i = hash_id(id) & obj_idx.id_mask; obj_idx.id_slots[i]; \
+         i = SLOT_NEXT(i, obj_idx.id_mask)) {
+        if (obj_idx.id_slots[i]->id == id)
+            return (int32_t)i;
+    }
+
+    return -1;
+}
+
+static void id_remove_slot(uint32_t hole)
+{
+    uint32_t i, home, mask = obj_idx.id_mask;
+
+    /* Move back every entry that can no longer be reached past the hole */
+    for (i = SLOT_NEXT(hole, mask); obj_idx.id_slots[i]; \
+         i = SLOT_NEXT(i, mask)) {
+        home = hash_id(obj_idx.id_slots[i]->id) & mask;
+        if (slot_between(hole, home, i))
+            continue;
+
+        obj_idx.id_slots[hole] = obj_idx.id_slots[i];
+        hole = i;
+    }
+
+    obj_idx.id_slots[hole] = NULL;
+    obj_idx.nr_ids--;
+}
+
+/*=====================
+ * Name table
+ *====================*/
+static void name_insert(name_slot_t *slots, uint32_t mask, name_slot_t *ent)
+{
+    uint32_t i = ent->hash & mask;
+
+    while (slots[i].first)
+        i = SLOT_NEXT(i, mask);
+
+    slots[i] = *ent;
+}
+
+static int32_t name_grow(void)
+{
+    uint32_t i, mask = obj_idx.name_mask ? obj_idx.name_mask * 2 + 1 : \
+                       OBJ_INDEX_MIN_SLOTS - 1;
+    name_slot_t *slots;
+
+    slots = calloc(mask + 1, sizeof(*slots));
+    if (!slots)
+        return -ENOMEM;
+
+    for (i = 0; obj_idx.name_slots && i <= obj_idx.name_mask; i++) {
+        if (obj_idx.name_slots[i].first)
+            name_insert(slots, mask, &obj_idx.name_slots[i]);
+    }
+
+    free(obj_idx.name_slots);
+    obj_idx.name_slots = slots;
+    obj_idx.name_mask = mask;
+    return 0;
+}
+
+static int32_t name_lookup(const char *name, uint32_t hash)
+{
+    name_slot_t *slot;
+    uint32_t i;
+
+    if (!obj_idx.name_slots)
+        return -1;
+
+    for (i = hash & obj_idx.name_mask; obj_idx.name_slots[i].first; \
+         i = SLOT_NEXT(i, obj_idx.name_mask)) {
+        slot = &obj_idx.name_slots[i];
+        if (slot->hash == hash && !strcmp(slot->first->name, name))
+            return (int32_t)i;
+    }
+
+    return -1;
+}
+
+static void name_remove_slot(uint32_t hole)
+{
+    uint32_t i, home, mask = obj_idx.name_mask;
+
+    for (i = SLOT_NEXT(hole, mask); obj_idx.name_slots[i].first; \
+         i = SLOT_NEXT(i, mask)) {
+        home = obj_idx.name_slots[i].hash & mask;
+        if (slot_between(hole, home, i))
+            continue;
+
+        obj_idx.name_slots[hole] = obj_idx.name_slots[i];
+        hole = i;
+    }
+
+    obj_idx.name_slots[hole].first = NULL;
+    obj_idx.nr_names--;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * obj_index_add - Index @meta by its id and, if it has one, by its name
+ *
+ * Objects sharing a name are chained in registration order, which is the
+ * order a depth-first scan meets siblings in.
+ *
+ * Return: 0 on success, -ENOMEM if a table could not grow.
+ */
+int32_t obj_index_add(obj_meta_t *meta)
+{
+    name_slot_t ent;
+    int32_t slot;
+
+    INIT_LIST_HEAD(&meta->name_node);
+
+    if (OVER_LOAD(obj_idx.nr_ids, obj_idx.id_mask) && id_grow())
+        return -ENOMEM;
+
+    if (!meta->name) {
+        id_insert(obj_idx.id_slots, obj_idx.id_mask, meta);
+        obj_idx.nr_ids++;
+        return 0;
+    }
+
+    ent.hash = hash_name(meta->name);
+    slot = name_lookup(meta->name, ent.hash);
+    if (slot >= 0) {
+        list_add_tail(&meta->name_node, \
+                      &obj_idx.name_slots[slot].first->name_node);
+    } else {
+        if (OVER_LOAD(obj_idx.nr_names, obj_idx.name_mask) && name_grow())
+            return -ENOMEM;
+
+        ent.first = meta;
+        name_insert(obj_idx.name_slots, obj_idx.name_mask, &ent);
+        obj_idx.nr_names++;
+    }
+
+    id_insert(obj_idx.id_slots, obj_idx.id_mask, meta);
+    obj_idx.nr_ids++;
+    return 0;
+}
+
+/* Drop @meta from the index, before it is freed */
+void obj_index_del(obj_meta_t *meta)
+{
+    name_slot_t *slot;
+    int32_t i;
+
+    i = id_lookup(meta->id);
+    if (i < 0 || obj_idx.id_slots[i] != meta)
+        return;
+
+    id_remove_slot((uint32_t)i);
+
+    if (!meta->name)
+        return;
+
+    i = name_lookup(meta->name, hash_name(meta->name));
+    if (i < 0)
+        return;
+
+    slot = &obj_idx.name_slots[i];
+    if (slot->first == meta) {
+        if (list_empty(&meta->name_node))
+            name_remove_slot((uint32_t)i);
+        else
+            slot->first = list_first_entry(&meta->name_node, obj_meta_t, \
+                                           name_node);
+    }
+    list_del_init(&meta->name_node);
+}
+
+obj_meta_t *obj_index_find_id(uint32_t id)
+{
+    int32_t i = id_lookup(id);
+
+    return i < 0 ? NULL : obj_idx.id_slots[i];
+}
+
+/*
+ * obj_index_find_name - First object registered with @name
+ *
+ * The others follow through their name_node, in registration order.
+ *
+ * Return: the object, NULL if none has this name.
+ */
+obj_meta_t *obj_index_find_name(const char *name)
+{
+    int32_t i = name_lookup(name, hash_name(name));
+
+    return i < 0 ? NULL : obj_idx.name_slots[i].first;
+}
+
+/* Forget every object, once the object tree is gone */
+void obj_index_reset(void)
+{
+    free(obj_idx.id_slots);
+    free(obj_idx.name_slots);
+    memset(&obj_idx, 0, sizeof(obj_idx));
+}
@@ -53,15 +53,18 @@ static inline int32_t config_padding_meta(lv_obj_t *lobj, int32_t pad_top, \
                                       int32_t pad_right)
 {
     obj_meta_t *meta;
+    obj_pad_t *pad;
 
     meta = lobj ? get_meta(lobj) : NULL;
     if (!meta)
         return -EINVAL;
 
-    meta->layout.pad_top = pad_top;
-    meta->layout.pad_bot = pad_bot;
-    meta->layout.pad_left = pad_left;
-    meta->layout.pad_right = pad_right;
+    pad = get_meta_pad(meta);
+    pad->pad_top = pad_top;
+    pad->pad_bot = pad_bot;
+    pad->pad_left = pad_left;
+    pad->pad_right = pad_right;
+    mark_meta_dirty(meta, OBJ_DIRTY_PADDING);
 
     return 0;
 }
@@ -74,7 +77,8 @@ static inline int32_t config_meta_row_padding(lv_obj_t *lobj, int32_t pad)
     if (!meta)
         return -EINVAL;
 
-    meta->layout.pad_row = pad;
+    get_meta_pad(meta)->pad_row = pad;
+    mark_meta_dirty(meta, OBJ_DIRTY_PADDING);
 
     return 0;
 }
@@ -87,7 +91,8 @@ static inline int32_t config_meta_column_padding(lv_obj_t *lobj, int32_t pad)
     if (!meta)
         return -EINVAL;
 
-    meta->layout.pad_column = pad;
+    get_meta_pad(meta)->pad_column = pad;
+    mark_meta_dirty(meta, OBJ_DIRTY_PADDING);
 
     return 0;
 }
@@ -100,7 +105,7 @@ static inline int32_t apply_meta_row_padding(lv_obj_t *lobj)
     if (!meta)
         return -EINVAL;
 
-    lv_obj_set_style_pad_row(lobj, meta->layout.pad_row, 0);
+    lv_obj_set_style_pad_row(lobj, get_meta_pad(meta)->pad_row, 0);
 
     return 0;
 }
@@ -113,7 +118,7 @@ static inline int32_t apply_meta_column_padding(lv_obj_t *lobj)
     if (!meta)
         return -EINVAL;
 
-    lv_obj_set_style_pad_column(lobj, meta->layout.pad_column, 0);
+    lv_obj_set_style_pad_column(lobj, get_meta_pad(meta)->pad_column, 0);
 
     return 0;
 }
@@ -123,6 +128,7 @@ static inline int32_t apply_meta_column_padding(lv_obj_t *lobj)
 int32_t rotate_padding_meta_90(lv_obj_t *lobj)
 {
     obj_meta_t *meta;
+    obj_pad_t *pad;
     int32_t tmp_pad = 0;
     int32_t ret = 0;
 
@@ -130,15 +136,16 @@ int32_t rotate_padding_meta_90(lv_obj_t *lobj)
     if (!lobj)
         return -EINVAL;
 
+    pad = get_meta_pad(meta);
     ret = config_padding_meta(lobj, \
-                               meta->layout.pad_left, meta->layout.pad_right, \
-                               meta->layout.pad_bot, meta->layout.pad_top);
+                               pad->pad_left, pad->pad_right, \
+                               pad->pad_bot, pad->pad_top);
     if (ret)
         return ret;
 
 
-    tmp_pad = meta->layout.pad_row;
-    ret = config_meta_row_padding(lobj, meta->layout.pad_column);
+    tmp_pad = pad->pad_row;
+    ret = config_meta_row_padding(lobj, pad->pad_column);
     if (ret)
         return ret;
 
@@ -152,15 +159,17 @@ int32_t rotate_padding_meta_90(lv_obj_t *lobj)
 int32_t apply_padding_meta(lv_obj_t *lobj)
 {
     obj_meta_t *meta;
+    obj_pad_t *pad;
 
     meta = lobj ? get_meta(lobj) : NULL;
     if (!meta)
         return -EINVAL;
 
-    lv_obj_set_style_pad_top(lobj, meta->layout.pad_top, 0);
-    lv_obj_set_style_pad_bottom(lobj, meta->layout.pad_bot, 0);
-    lv_obj_set_style_pad_left(lobj, meta->layout.pad_left, 0);
-    lv_obj_set_style_pad_right(lobj, meta->layout.pad_right, 0);
+    pad = get_meta_pad(meta);
+    lv_obj_set_style_pad_top(lobj, pad->pad_top, 0);
+    lv_obj_set_style_pad_bottom(lobj, pad->pad_bot, 0);
+    lv_obj_set_style_pad_left(lobj, pad->pad_left, 0);
+    lv_obj_set_style_pad_right(lobj, pad->pad_right, 0);
 
     return 0;
 }
@@ -173,8 +182,8 @@ int32_t apply_row_column_padding_meta(lv_obj_t *lobj)
     if (!meta)
         return -EINVAL;
 
-    lv_obj_set_style_pad_row(lobj, meta->layout.pad_row, 0);
-    lv_obj_set_style_pad_column(lobj, meta->layout.pad_column, 0);
+    lv_obj_set_style_pad_row(lobj, get_meta_pad(meta)->pad_row, 0);
+    lv_obj_set_style_pad_column(lobj, get_meta_pad(meta)->pad_column, 0);
 
     return 0;
 }
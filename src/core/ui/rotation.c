@@ -13,6 +13,7 @@
 #include "log.h"
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <errno.h>
 
 #include <lvgl.h>
@@ -37,6 +38,7 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static int32_t refresh_object_tree(lv_obj_t *lobj, bool force);
 
 /**********************
  *  STATIC VARIABLES
@@ -60,7 +62,7 @@ static int8_t calc_rotation_turn(lv_obj_t *lobj)
     if (!meta)
         return -EINVAL;
 
-    cur_rot = meta->data.rotation;
+    cur_rot = get_meta_rotation(meta);
     scr_rot = get_scr_rotation();
 
     if (cur_rot < ROTATION_0 || cur_rot > ROTATION_270 ||
@@ -169,7 +171,7 @@ static inline int32_t rotate_common_post_adjust(lv_obj_t *lobj)
         return -EINVAL;
 
     /* Recalculate alignment values if needed */
-    if (meta->align.value != LV_ALIGN_DEFAULT) {
+    if (get_meta_align(meta)->value != LV_ALIGN_DEFAULT) {
         ret = rotate_alignment_meta(lobj);
         if (ret)
             return -EINVAL;
@@ -191,7 +193,7 @@ static inline int32_t rotate_common_post_adjust(lv_obj_t *lobj)
      * recalculated based on the logical rotation. Using this new center,
      * the width and height can then be updated accordingly.
      */
-    if (meta->align.value == LV_ALIGN_DEFAULT) {
+    if (get_meta_align(meta)->value == LV_ALIGN_DEFAULT) {
         par_w = get_par_w(lobj);
         par_h = get_par_h(lobj);
 
@@ -199,8 +201,8 @@ static inline int32_t rotate_common_post_adjust(lv_obj_t *lobj)
         if (ret)
             return -EINVAL;
 
-        lv_obj_set_pos(lobj, meta->align.mid_x - (get_w(lobj) / 2), \
-                       meta->align.mid_y - (get_h(lobj) / 2));
+        lv_obj_set_pos(lobj, get_meta_align(meta)->mid_x - (get_w(lobj) / 2), \
+                       get_meta_align(meta)->mid_y - (get_h(lobj) / 2));
     } else {
         apply_align_meta(lobj);
     }
@@ -250,6 +252,7 @@ static inline int32_t rotate_visual_object(lv_obj_t *lobj)
     int32_t scr_rot = get_scr_rotation();
     int32_t rot_val = 0;
     obj_meta_t *meta;
+    obj_align_t *aln;
 
     meta = lobj ? get_meta(lobj) : NULL;
     if (!meta)
@@ -265,26 +268,28 @@ static inline int32_t rotate_visual_object(lv_obj_t *lobj)
         return -EINVAL;
     }
 
+    aln = get_meta_align(meta);
+
     if (scr_rot == ROTATION_0) {
         rot_val = 0;
         lv_obj_set_style_transform_rotation(lobj, rot_val, 0);
-        lv_obj_set_pos(lobj, meta->align.mid_x - (get_w(lobj) / 2), \
-                       meta->align.mid_y - (get_h(lobj) / 2));
+        lv_obj_set_pos(lobj, aln->mid_x - (get_w(lobj) / 2), \
+                       aln->mid_y - (get_h(lobj) / 2));
     } else if (scr_rot == ROTATION_90) {
         rot_val = 900;
         lv_obj_set_style_transform_rotation(lobj, rot_val, 0);
-        lv_obj_set_pos(lobj, meta->align.mid_x + (get_w(lobj) / 2), \
-                       meta->align.mid_y - (get_h(lobj) / 2));
+        lv_obj_set_pos(lobj, aln->mid_x + (get_w(lobj) / 2), \
+                       aln->mid_y - (get_h(lobj) / 2));
     } else if (scr_rot == ROTATION_180) {
         rot_val = 1800;
         lv_obj_set_style_transform_rotation(lobj, rot_val, 0);
-        lv_obj_set_pos(lobj, meta->align.mid_x + (get_w(lobj) / 2), \
-                       meta->align.mid_y + (get_h(lobj) / 2));
+        lv_obj_set_pos(lobj, aln->mid_x + (get_w(lobj) / 2), \
+                       aln->mid_y + (get_h(lobj) / 2));
     } else if (scr_rot == ROTATION_270) {
         rot_val = 2700;
         lv_obj_set_style_transform_rotation(lobj, rot_val, 0);
-        lv_obj_set_pos(lobj, meta->align.mid_x - (get_w(lobj) / 2), \
-                       meta->align.mid_y + (get_h(lobj) / 2));
+        lv_obj_set_pos(lobj, aln->mid_x - (get_w(lobj) / 2), \
+                       aln->mid_y + (get_h(lobj) / 2));
     }
 
     return 0;
@@ -564,7 +569,7 @@ static int32_t refresh_object(lv_obj_t *lobj)
 
 
     // NOTE: Refresh now applies beyond rotation
-    // if (meta->data.rotation == scr_rot)
+    // if (get_meta_rotation(meta) == scr_rot)
     //     return 0;
 
     // TODO: check obj type and update list flow, scale...
@@ -576,12 +581,12 @@ static int32_t refresh_object(lv_obj_t *lobj)
         return ret;
     }
 
-    meta->data.rotation = get_scr_rotation();
+    set_meta_rotation(meta, get_scr_rotation());
 
     return 0;
 }
 
-static int32_t refresh_object_child(lv_obj_t *lobj)
+static int32_t refresh_object_child(lv_obj_t *lobj, bool force)
 {
     int32_t ret;
     struct list_head *par_list;
@@ -595,7 +600,10 @@ static int32_t refresh_object_child(lv_obj_t *lobj)
     par_list = &meta->child;
 
     list_for_each_entry(child_meta, par_list, node) {
-        ret = refresh_object_tree_layout(get_lobj(child_meta));
+        if (!force && !get_meta_dirty(child_meta))
+            continue;
+
+        ret = refresh_object_tree(get_lobj(child_meta), force);
         if (ret < 0) {
             LOG_ERROR("List: Object %d (%s) rotation failed", \
                       child_meta->id, get_meta_name(child_meta));
@@ -606,37 +614,11 @@ static int32_t refresh_object_child(lv_obj_t *lobj)
     return 0;
 }
 
-/**********************
- *   GLOBAL FUNCTIONS
- **********************/
-int32_t set_scr_rotation(int32_t rot_dir)
-{
-    ctx_t *ctx = get_ctx();
-    if (ctx == NULL)
-        return -EINVAL;
-
-    ctx->scr.rotation = rot_dir;
-
-    return 0;
-}
-
-int32_t get_scr_rotation()
-{
-    ctx_t *ctx = get_ctx();
-    if (ctx == NULL)
-        return -EINVAL;
-
-    return ctx->scr.rotation;
-}
-
 /*
- * This function handles object layout updates including rotation, scaling,
- * and repositioning. Each object may define its own callbacks for move,
- * scale, or rotate, which will be invoked during the rotation job.
- * Although primarily used for rotation checks and updates, it may trigger
- * broader layout adjustments.
+ * @force: a parent was transformed, sizes and cells below follow it, so
+ *         the whole subtree is redone whatever its flags.
  */
-int32_t refresh_object_tree_layout(lv_obj_t *lobj)
+static int32_t refresh_object_tree(lv_obj_t *lobj, bool force)
 {
     int32_t ret;
     obj_meta_t *meta;
@@ -645,14 +627,23 @@ int32_t refresh_object_tree_layout(lv_obj_t *lobj)
     if (!meta)
         return -EINVAL;
 
-    ret = refresh_object(lobj);
-    if (ret < 0) {
-        LOG_ERROR("Object [%s] id %d rotation failed", \
-                  get_name(lobj), meta->id);
-        return ret;
+    if (!force && !get_meta_dirty(meta))
+        return 0;
+
+    if (force || (get_meta_dirty(meta) & OBJ_DIRTY_SELF)) {
+        ret = refresh_object(lobj);
+        if (ret < 0) {
+            LOG_ERROR("Object [%s] id %d rotation failed", \
+                      get_name(lobj), meta->id);
+            return ret;
+        }
+
+        /* Also drops the flags raised by the transform itself */
+        clear_meta_dirty(meta, OBJ_DIRTY_SELF);
+        force = true;
     }
 
-    ret = refresh_object_child(lobj);
+    ret = refresh_object_child(lobj, force);
     if (ret < 0) {
         LOG_ERROR("Object [%s] id %d: child rotation failed", \
                   get_name(lobj), meta->id);
@@ -674,5 +665,72 @@ int32_t refresh_object_tree_layout(lv_obj_t *lobj)
             LOG_WARN("Scroll [%s] to first child failed", get_name(lobj));
     }
 
+    /*
+     * The callback reworks this object itself, what it flags on it is
+     * already applied. Children it flagged still need a pass, and CHILD is
+     * only dropped once nothing below is dirty, so a clean parent never
+     * hides a dirty object.
+     */
+    if (get_meta_dirty(meta) & OBJ_DIRTY_CHILD) {
+        ret = refresh_object_child(lobj, false);
+        if (ret < 0) {
+            LOG_ERROR("Object [%s] id %d: child rotation failed", \
+                      get_name(lobj), meta->id);
+            return ret;
+        }
+    }
+
+    clear_meta_dirty(meta, OBJ_DIRTY_SELF | OBJ_DIRTY_CHILD);
+
+    return 0;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+int32_t set_scr_rotation(int32_t rot_dir)
+{
+    ctx_t *ctx = get_ctx();
+    if (ctx == NULL)
+        return -EINVAL;
+
+    if (ctx->scr.rotation != rot_dir)
+        mark_all_dirty(OBJ_DIRTY_ROTATION);
+
+    ctx->scr.rotation = rot_dir;
+
     return 0;
 }
+
+int32_t get_scr_rotation()
+{
+    ctx_t *ctx = get_ctx();
+    if (ctx == NULL)
+        return -EINVAL;
+
+    return ctx->scr.rotation;
+}
+
+/*
+ * This function handles object layout updates including rotation, scaling,
+ * and repositioning. Each object may define its own callbacks for move,
+ * scale, or rotate, which will be invoked during the rotation job.
+ * Although primarily used for rotation checks and updates, it may trigger
+ * broader layout adjustments.
+ *
+ * The size, alignment, padding and rotation rewritten here live in the
+ * obj_geom side table. A subtree built in one go sits there in the order
+ * this depth-first walk visits it, so the walk reads them sequentially.
+ *
+ * Only dirty objects are redone, see mark_meta_dirty(). A transformed object
+ * takes its whole subtree with it, a clean one is skipped along with its
+ * children unless OBJ_DIRTY_CHILD says one of them changed. Flags are kept
+ * on failure, so the next call tries again.
+ */
+int32_t refresh_object_tree_layout(lv_obj_t *lobj)
+{
+    if (!lobj || !get_meta(lobj))
+        return -EINVAL;
+
+    return refresh_object_tree(lobj, false);
+}
@@ -58,22 +58,24 @@ int32_t rotate_size_meta_90(lv_obj_t *lobj)
     int32_t tmp_par_w_pct;
     int32_t tmp_w_scale;
     obj_meta_t *meta;
+    obj_size_t *size;
 
     meta = lobj ? get_meta(lobj) : NULL;
     if (!meta)
         return -EINVAL;
 
-    tmp_w = meta->size.w;
-    tmp_par_w_pct = meta->size.par_w_pct;
-    tmp_w_scale = meta->size.scale_w;
+    size = get_meta_size(meta);
+    tmp_w = size->w;
+    tmp_par_w_pct = size->par_w_pct;
+    tmp_w_scale = size->scale_w;
 
-    meta->size.w = meta->size.h;
-    meta->size.par_w_pct = meta->size.par_h_pct;
-    meta->size.scale_w = meta->size.scale_h;
+    size->w = size->h;
+    size->par_w_pct = size->par_h_pct;
+    size->scale_w = size->scale_h;
 
-    meta->size.h = tmp_w;
-    meta->size.par_h_pct = tmp_par_w_pct;
-    meta->size.scale_h = tmp_w_scale;
+    size->h = tmp_w;
+    size->par_h_pct = tmp_par_w_pct;
+    size->scale_h = tmp_w_scale;
 
     return 0;
 }
@@ -114,15 +116,17 @@ int32_t get_scr_height(void)
 void set_size(lv_obj_t *lobj, int32_t px_x, int32_t px_y)
 {
     obj_meta_t *meta = NULL;
+    obj_size_t *size;
     LV_ASSERT_NULL(lobj);
 
     meta = get_meta(lobj);
-    meta->size.w = px_x;
-    meta->size.h = px_y;
-    meta->size.par_w_pct = 0;
-    meta->size.par_h_pct = 0;
-    meta->size.scale_w = DIS_SCALE;
-    meta->size.scale_h = DIS_SCALE;
+    size = get_meta_size(meta);
+    size->w = px_x;
+    size->h = px_y;
+    size->par_w_pct = 0;
+    size->par_h_pct = 0;
+    size->scale_w = DIS_SCALE;
+    size->scale_h = DIS_SCALE;
 
     apply_size_meta(lobj);
 }
@@ -134,17 +138,19 @@ void set_size(lv_obj_t *lobj, int32_t px_x, int32_t px_y)
 void set_size_scale_w(lv_obj_t *lobj, int32_t pct_x, int32_t px_y)
 {
     obj_meta_t *meta = NULL;
+    obj_size_t *size;
     LV_ASSERT_NULL(lobj);
 
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
 
-    meta->size.w = 0;
-    meta->size.h = px_y;
-    meta->size.par_w_pct = pct_x;
-    meta->size.par_h_pct = 0;
-    meta->size.scale_w = ENA_SCALE;
-    meta->size.scale_h = DIS_SCALE;
+    size = get_meta_size(meta);
+    size->w = 0;
+    size->h = px_y;
+    size->par_w_pct = pct_x;
+    size->par_h_pct = 0;
+    size->scale_w = ENA_SCALE;
+    size->scale_h = DIS_SCALE;
 
     apply_size_meta(lobj);
 }
@@ -156,17 +162,19 @@ void set_size_scale_w(lv_obj_t *lobj, int32_t pct_x, int32_t px_y)
 void set_size_scale_h(lv_obj_t *lobj, int32_t px_x, int32_t pct_y)
 {
     obj_meta_t *meta = NULL;
+    obj_size_t *size;
     LV_ASSERT_NULL(lobj);
 
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
 
-    meta->size.w = px_x;
-    meta->size.h = 0;
-    meta->size.par_w_pct = 0;
-    meta->size.par_h_pct = pct_y;
-    meta->size.scale_w = DIS_SCALE;
-    meta->size.scale_h = ENA_SCALE;
+    size = get_meta_size(meta);
+    size->w = px_x;
+    size->h = 0;
+    size->par_w_pct = 0;
+    size->par_h_pct = pct_y;
+    size->scale_w = DIS_SCALE;
+    size->scale_h = ENA_SCALE;
 
     apply_size_meta(lobj);
 }
@@ -178,17 +186,19 @@ void set_size_scale_h(lv_obj_t *lobj, int32_t px_x, int32_t pct_y)
 void set_size_scale(lv_obj_t *lobj, int32_t pct_x, int32_t pct_y)
 {
     obj_meta_t *meta = NULL;
+    obj_size_t *size;
     LV_ASSERT_NULL(lobj);
 
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
 
-    meta->size.w = 0;
-    meta->size.h = 0;
-    meta->size.par_w_pct = pct_x;
-    meta->size.par_h_pct = pct_y;
-    meta->size.scale_w = ENA_SCALE;
-    meta->size.scale_h = ENA_SCALE;
+    size = get_meta_size(meta);
+    size->w = 0;
+    size->h = 0;
+    size->par_w_pct = pct_x;
+    size->par_h_pct = pct_y;
+    size->scale_w = ENA_SCALE;
+    size->scale_h = ENA_SCALE;
 
     apply_size_meta(lobj);
 }
@@ -202,35 +212,38 @@ void set_size_scale(lv_obj_t *lobj, int32_t pct_x, int32_t pct_y)
 void apply_size_meta(lv_obj_t *lobj)
 {
     obj_meta_t *meta = NULL;
+    obj_size_t *size;
 
     LV_ASSERT_NULL(lobj);
     meta = get_meta(lobj);
     LV_ASSERT_NULL(meta);
 
-    if (meta->size.scale_w == ENA_SCALE) {
+    size = get_meta_size(meta);
+    if (size->scale_w == ENA_SCALE) {
         // percent to pixel
-        meta->size.w = pct_to_px(get_par_w(lobj), meta->size.par_w_pct);
+        size->w = pct_to_px(get_par_w(lobj), size->par_w_pct);
     } else {
         // Update object size in percent-based scaling
         // Pixel to percent
-        meta->size.par_w_pct =  px_to_pct(get_par_w(lobj), get_w(lobj));
+        size->par_w_pct =  px_to_pct(get_par_w(lobj), get_w(lobj));
         LOG_TRACE("Update obj W size [%d] -> percent [%d]", \
-                  get_w(lobj), meta->size.par_w_pct);
+                  get_w(lobj), size->par_w_pct);
     }
 
 
-    if (meta->size.scale_h == ENA_SCALE) {
+    if (size->scale_h == ENA_SCALE) {
         // percent to pixel
-        meta->size.h = pct_to_px(get_par_h(lobj), meta->size.par_h_pct);
+        size->h = pct_to_px(get_par_h(lobj), size->par_h_pct);
     } else {
         // Update object size in percent-based scaling
         // Pixel to percent
-        meta->size.par_h_pct =  px_to_pct(get_par_h(lobj), get_h(lobj));
+        size->par_h_pct =  px_to_pct(get_par_h(lobj), get_h(lobj));
         LOG_TRACE("Update obj H size [%d] -> percent [%d]", \
-                  get_h(lobj), meta->size.par_h_pct);
+                  get_h(lobj), size->par_h_pct);
     }
 
-    lv_obj_set_size(lobj, meta->size.w, meta->size.h);
+    lv_obj_set_size(lobj, size->w, size->h);
+    mark_meta_dirty(meta, OBJ_DIRTY_GEOMETRY);
 }
 
 /*
@@ -245,6 +258,7 @@ void apply_size_meta(lv_obj_t *lobj)
 int32_t store_computed_size(lv_obj_t *lobj)
 {
     obj_meta_t *meta;
+    obj_size_t *size;
     int32_t w, h;
 
     meta = lobj ? get_meta(lobj) : NULL;
@@ -263,20 +277,22 @@ int32_t store_computed_size(lv_obj_t *lobj)
         return -EIO;
     }
 
-    meta->size.par_w_pct = px_to_pct(get_par_w(lobj), w);
-    meta->size.w = w;
-    meta->size.par_h_pct = px_to_pct(get_par_h(lobj), h);
-    meta->size.h = h;
+    size = get_meta_size(meta);
+    size->par_w_pct = px_to_pct(get_par_w(lobj), w);
+    size->w = w;
+    size->par_h_pct = px_to_pct(get_par_h(lobj), h);
+    size->h = h;
+    mark_meta_dirty(meta, OBJ_DIRTY_GEOMETRY);
 
     LOG_TRACE("Update object [%s] size\nParent Width [%d] - Height [%d]\n"\
              "Storaged size Width [%d or %d\%] - Height [%d or %d\%]", \
              meta->name, \
              get_par_w(lobj), \
              get_par_h(lobj), \
-             meta->size.w, \
-             meta->size.par_w_pct, \
-             meta->size.h, \
-             meta->size.par_h_pct);
+             size->w, \
+             size->par_w_pct, \
+             size->h, \
+             size->par_h_pct);
 
     return 0;
 }
@@ -0,0 +1,216 @@
+/**
+ * @file ui_lane.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "sched/ring.h"
+#include "ui/ui_lane.h"
+#include "main.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct ui_msg {
+    ui_cb_t cb;
+    void *arg;
+} ui_msg_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/*
+ * Workers post UI mutations here instead of lv_async_call(), which creates
+ * an LVGL timer per call and is not safe from other threads. The UI thread
+ * drains the ring once per main loop iteration, so every update posted
+ * before a frame is applied in that frame, in posting order.
+ */
+static ring_t *ui_ring;
+static pthread_t ui_thread;
+
+/*
+ * Producers announce themselves before looking at lane_closed, so once
+ * the lane is closed and nr_posters drops to zero no one can touch the
+ * ring anymore. The DBus listener is never joined, it may still post.
+ */
+static atomic_bool lane_closed;
+static atomic_int nr_posters;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static int32_t lane_push(ui_cb_t cb, void *arg, bool wait)
+{
+    ui_msg_t msg = { .cb = cb, .arg = arg };
+    int32_t ret = -ESHUTDOWN;
+
+    atomic_fetch_add(&nr_posters, 1);
+    while (!atomic_load(&lane_closed)) {
+        if (!ring_push(ui_ring, &msg)) {
+            ret = 0;
+            break;
+        }
+
+        if (!wait) {
+            ret = -EAGAIN;
+            break;
+        }
+
+        if (!get_ctx()->run)
+            break;
+
+        LOG_TRACE("UI lane full, waiting for the next frame");
+        usleep(UI_LANE_RETRY_US);
+    }
+    atomic_fetch_sub(&nr_posters, 1);
+
+    return ret;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/* Must be called from the thread running the LVGL main loop */
+int32_t ui_lane_init(void)
+{
+    ui_ring = ring_create(UI_LANE_SLOTS, sizeof(ui_msg_t));
+    if (!ui_ring) {
+        LOG_FATAL("Unable to allocate the UI message lane");
+        return -ENOMEM;
+    }
+
+    ui_thread = pthread_self();
+    atomic_store(&lane_closed, false);
+    return 0;
+}
+
+/*
+ * Close the lane, then run what was still queued so the posted arguments
+ * are released by their callbacks. Called from the UI thread.
+ */
+void ui_lane_deinit(void)
+{
+    ui_msg_t msg;
+
+    if (!ui_ring)
+        return;
+
+    atomic_store(&lane_closed, true);
+    while (atomic_load(&nr_posters))
+        usleep(UI_LANE_RETRY_US);
+
+    while (!ring_pop(ui_ring, &msg))
+        msg.cb(msg.arg);
+
+    ring_destroy(ui_ring);
+    ui_ring = NULL;
+}
+
+/*
+ * ui_post - Run @cb(@arg) on the UI thread before the next frame
+ *
+ * Called from the UI thread itself, @cb runs at once. When the lane is
+ * full the caller waits for the UI thread to make room, so updates are
+ * never dropped nor reordered. Only for workers, the DBus listener must
+ * not wait on a frame and uses ui_try_post().
+ *
+ * Return: 0 on success, -ENODEV before init, -ESHUTDOWN once the lane is
+ * closed or the service stops while waiting.
+ */
+int32_t ui_post(ui_cb_t cb, void *arg)
+{
+    if (!cb)
+        return -EINVAL;
+
+    if (!ui_ring)
+        return -ENODEV;
+
+    if (pthread_equal(pthread_self(), ui_thread)) {
+        cb(arg);
+        return 0;
+    }
+
+    return lane_push(cb, arg, true);
+}
+
+/*
+ * ui_try_post - Same as ui_post(), without waiting for room
+ *
+ * Return: 0 on success, -EAGAIN if the lane is full, or an error of
+ * ui_post(). @arg is left to the caller on failure.
+ */
+int32_t ui_try_post(ui_cb_t cb, void *arg)
+{
+    if (!cb)
+        return -EINVAL;
+
+    if (!ui_ring)
+        return -ENODEV;
+
+    if (pthread_equal(pthread_self(), ui_thread)) {
+        cb(arg);
+        return 0;
+    }
+
+    return lane_push(cb, arg, false);
+}
+
+/*
+ * ui_lane_drain - Run the callbacks posted so far, from the UI thread
+ *
+ * At most one lane worth of messages is handled per call, so a producer
+ * that keeps posting cannot hold back the frame.
+ *
+ * Return: the number of callbacks run.
+ */
+int32_t ui_lane_drain(void)
+{
+    ui_msg_t msg;
+    int32_t nr = 0;
+
+    if (!ui_ring)
+        return 0;
+
+    while (nr < UI_LANE_SLOTS && !ring_pop(ui_ring, &msg)) {
+        msg.cb(msg.arg);
+        nr++;
+    }
+
+    if (nr) {
+        LOG_TRACE("UI lane: %d updates applied", nr);
+    }
+
+    return nr;
+}
@@ -260,6 +260,9 @@ static int32_t load_window(view_ctn_t *v_ctx)
 {
     lv_obj_t *parent;
     lv_obj_t *window;
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    obj_footprint_t fp;
+#endif
     char name_buf[64];
     lv_obj_t *(*create_window_cb)(lv_obj_t *, const char *, view_ctn_t *);
 
@@ -284,6 +287,14 @@ static int32_t load_window(view_ctn_t *v_ctx)
     LOG_TRACE("<--- Created window [%s] |", \
               get_name(v_ctx->opened_ctn->overlay_menu));
 
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    /* Walks the whole window, only worth it when the line is printed */
+    if (!get_obj_footprint(window, &fp))
+        LOG_DEBUG("Window [%s]: %u objects, %zu B of metadata, " \
+                  "%u names in %zu B", name_buf, fp.nr_objs, fp.meta_bytes, \
+                  fp.nr_named, fp.name_bytes);
+#endif
+
     return refresh_object_tree_layout(window);
 }
 
@@ -330,7 +341,7 @@ static int32_t create_window_container(lv_obj_t *view, enum container_side side)
             set_grid_cell_align(container, \
                                 LV_GRID_ALIGN_STRETCH, 0, 1, \
                                 LV_GRID_ALIGN_STRETCH, 0, 1);
-            get_meta(container)->data.rotation = ROTATION_180;
+            set_meta_rotation(get_meta(container), ROTATION_180);
         }
 
         view_ctx->r_ctn.container = container;
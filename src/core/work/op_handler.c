@@ -0,0 +1,146 @@
+/**
+ * @file op_handler.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "list.h"
+#include "comm/cmd_payload.h"
+#include "sched/op_handler.h"
+#include "ui/ui_lane.h"
+#include "main.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/* Direct index over ctx->op.handler_lst, the list owns the entries */
+static const op_entry_t *op_table[OP_ID_END];
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+/* Runs on the UI thread, the command is released once handled */
+static void op_ui_run(void *arg)
+{
+    remote_cmd_t *cmd = arg;
+    int32_t ret;
+
+    ret = op_run(cmd->opcode, cmd);
+    if (ret) {
+        LOG_ERROR("UI handler of opcode [%d] failed with ret=%d", \
+                  cmd->opcode, ret);
+    }
+
+    delete_remote_cmd(cmd);
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * op_register - Install @ent as the handler of its opcode
+ *
+ * @ent must stay valid until op_unregister_all(). Not safe against
+ * concurrent lookups, register before the works start flowing.
+ *
+ * Return: 0 on success, -EINVAL on a bad entry, -EEXIST if the opcode is
+ * already handled.
+ */
+int32_t op_register(op_entry_t *ent)
+{
+    struct list_head *lst = &get_ctx()->op.handler_lst;
+
+    if (!ent || !ent->fn || ent->opcode <= OP_NONE || \
+        ent->opcode >= OP_ID_END || ent->prio >= NR_WORK_PRIO) {
+        LOG_ERROR("Invalid opcode handler");
+        return -EINVAL;
+    }
+
+    if (op_table[ent->opcode]) {
+        LOG_ERROR("Opcode [%d] is already handled", ent->opcode);
+        return -EEXIST;
+    }
+
+    list_add_tail(&ent->node, lst);
+    op_table[ent->opcode] = ent;
+
+    return 0;
+}
+
+void op_unregister_all(void)
+{
+    struct list_head *lst = &get_ctx()->op.handler_lst;
+    op_entry_t *ent, *tmp;
+
+    list_for_each_entry_safe(ent, tmp, lst, node) {
+        list_del_init(&ent->node);
+        op_table[ent->opcode] = NULL;
+    }
+}
+
+const op_entry_t *op_lookup(uint32_t opcode)
+{
+    if (opcode >= OP_ID_END)
+        return NULL;
+
+    return op_table[opcode];
+}
+
+/* Run the handler of @opcode in the calling thread */
+int32_t op_run(uint32_t opcode, void *data)
+{
+    const op_entry_t *ent = op_lookup(opcode);
+
+    if (!ent) {
+        LOG_ERROR("Opcode [%d] is invalid", opcode);
+        return -ENOENT;
+    }
+
+    return ent->fn(data);
+}
+
+/*
+ * op_post_ui - Hand @cmd to its handler on the UI thread
+ *
+ * Called from the DBus listener, it never waits for the UI thread.
+ *
+ * Return: 0 on success, the command then belongs to the UI thread.
+ * -EAGAIN if the UI lane is full.
+ */
+int32_t op_post_ui(remote_cmd_t *cmd)
+{
+    return ui_try_post(op_ui_run, cmd);
+}
@@ -0,0 +1,228 @@
+/**
+ * @file ring.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+
+#include "sched/ring.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct ring_cell {
+    atomic_size_t seq;
+    _Atomic uint64_t stamp;             /* Caller defined, e.g. enqueue time */
+    uint8_t data[];
+} ring_cell_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+#define ALIGN_UP(x, a)                  (((x) + (a) - 1) & ~((size_t)(a) - 1))
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static inline ring_cell_t *cell_at(ring_t *r, size_t pos)
+{
+    return (ring_cell_t *)(r->cells + (pos & r->mask) * r->stride);
+}
+
+static uint32_t round_up_pow2(uint32_t v)
+{
+    uint32_t p = 1;
+
+    while (p < v)
+        p <<= 1;
+
+    return p;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * ring_create - Allocate a ring holding at least @nr_slots elements
+ * @nr_slots:  requested capacity, rounded up to a power of two
+ * @elem_size: size in bytes of one element, copied on push and pop
+ *
+ * Return: the ring on success, NULL on failure.
+ */
+ring_t *ring_create(uint32_t nr_slots, uint32_t elem_size)
+{
+    ring_t *r;
+    size_t i, slots;
+
+    if (nr_slots < 2 || elem_size == 0)
+        return NULL;
+
+    r = aligned_alloc(RING_CACHELINE, ALIGN_UP(sizeof(*r), RING_CACHELINE));
+    if (!r)
+        return NULL;
+
+    slots = round_up_pow2(nr_slots);
+    r->mask = slots - 1;
+    r->elem_size = elem_size;
+    r->stride = ALIGN_UP(sizeof(ring_cell_t) + elem_size, sizeof(uint64_t));
+
+    r->cells = aligned_alloc(RING_CACHELINE, \
+                             ALIGN_UP(slots * r->stride, RING_CACHELINE));
+    if (!r->cells) {
+        free(r);
+        return NULL;
+    }
+
+    for (i = 0; i < slots; i++) {
+        atomic_init(&cell_at(r, i)->seq, i);
+        atomic_init(&cell_at(r, i)->stamp, 0);
+    }
+
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+
+    LOG_TRACE("Ring created: %zu slots of %u bytes", slots, elem_size);
+    return r;
+}
+
+void ring_destroy(ring_t *r)
+{
+    if (!r)
+        return;
+
+    free(r->cells);
+    free(r);
+}
+
+/*
+ * ring_push_stamp - Copy @elem into the ring, tagged with @stamp
+ *
+ * Return: 0 on success, -EAGAIN when the ring is full.
+ */
+int32_t ring_push_stamp(ring_t *r, const void *elem, uint64_t stamp)
+{
+    ring_cell_t *cell;
+    size_t pos, seq;
+    intptr_t diff;
+
+    pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    for (;;) {
+        cell = cell_at(r, pos);
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->tail, &pos, pos + 1, \
+                                                      memory_order_relaxed, \
+                                                      memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return -EAGAIN;
+        } else {
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        }
+    }
+
+    memcpy(cell->data, elem, r->elem_size);
+    atomic_store_explicit(&cell->stamp, stamp, memory_order_relaxed);
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    return 0;
+}
+
+/*
+ * ring_pop - Copy the oldest element into @elem and release its slot
+ *
+ * Return: 0 on success, -EAGAIN when the ring is empty.
+ */
+int32_t ring_pop(ring_t *r, void *elem)
+{
+    ring_cell_t *cell;
+    size_t pos, seq;
+    intptr_t diff;
+
+    pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    for (;;) {
+        cell = cell_at(r, pos);
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->head, &pos, pos + 1, \
+                                                      memory_order_relaxed, \
+                                                      memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return -EAGAIN;
+        } else {
+            pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+        }
+    }
+
+    memcpy(elem, cell->data, r->elem_size);
+    atomic_store_explicit(&cell->seq, pos + r->mask + 1, memory_order_release);
+
+    return 0;
+}
+
+/*
+ * ring_peek_stamp - Read the stamp of the oldest element without popping it
+ *
+ * The result is only a hint: the element may be consumed right after.
+ *
+ * Return: 0 when an element is available, -EAGAIN when the ring is empty.
+ */
+int32_t ring_peek_stamp(ring_t *r, uint64_t *stamp)
+{
+    ring_cell_t *cell;
+    size_t pos, seq;
+
+    pos = atomic_load_explicit(&r->head, memory_order_acquire);
+    cell = cell_at(r, pos);
+    seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    if (seq != pos + 1)
+        return -EAGAIN;
+
+    *stamp = atomic_load_explicit(&cell->stamp, memory_order_relaxed);
+    return 0;
+}
+
+/* Approximate number of queued elements */
+size_t ring_count(ring_t *r)
+{
+    size_t head, tail;
+
+    head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    return tail > head ? tail - head : 0;
+}
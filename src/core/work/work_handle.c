@@ -0,0 +1,273 @@
+/**
+ * @file work_handle.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+
+#include "util.h"
+#include "mem/obj_pool.h"
+#include "sched/workqueue.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static obj_pool_t handle_pool = OBJ_POOL_INITIALIZER("work_handle", \
+                                                     work_handle_t);
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static work_handle_t *create_handle(work_done_cb_t cb, void *arg)
+{
+    pthread_condattr_t attr;
+    work_handle_t *h;
+
+    h = obj_pool_zalloc(&handle_pool);
+    if (!h)
+        return NULL;
+
+    atomic_init(&h->refs, 2);
+    atomic_init(&h->state, WORK_STATE_PENDING);
+    h->done_cb = cb;
+    h->done_arg = arg;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&h->mutex, NULL);
+    pthread_cond_init(&h->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    return h;
+}
+
+/*
+ * Move @h from @from to the final @state and notify waiters, then the
+ * callback. Only one transition to a final state can succeed.
+ */
+static bool handle_finish(work_handle_t *h, int32_t from, int32_t state, \
+                          int32_t result)
+{
+    pthread_mutex_lock(&h->mutex);
+    if (!atomic_compare_exchange_strong(&h->state, &from, state)) {
+        pthread_mutex_unlock(&h->mutex);
+        return false;
+    }
+
+    h->result = result;
+    pthread_cond_broadcast(&h->cond);
+    pthread_mutex_unlock(&h->mutex);
+
+    if (h->done_cb)
+        h->done_cb(result, h->done_arg);
+
+    return true;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * push_work_tracked - Queue @w and return a handle to follow it
+ * @cb:  optional, called once from the thread completing or cancelling it
+ * @arg: passed to @cb
+ *
+ * The caller must drop the handle with work_handle_put() when done with it,
+ * the work keeps its own reference until it is released.
+ *
+ * Return: the handle, or NULL on failure in which case @w is not queued and
+ * still belongs to the caller.
+ */
+work_handle_t *push_work_tracked(workqueue_t *wq, work_t *w, \
+                                 work_done_cb_t cb, void *arg)
+{
+    work_handle_t *h;
+
+    if (wq == NULL || w == NULL || w->handle) {
+        LOG_ERROR("Workqueue data is invalid");
+        return NULL;
+    }
+
+    h = create_handle(cb, arg);
+    if (!h)
+        return NULL;
+
+    w->handle = h;
+    push_work(wq, w);
+
+    return h;
+}
+
+/*
+ * work_cancel - Cancel a tracked work that has not started yet
+ *
+ * Waiters and the callback are notified at once with -ECANCELED. The work
+ * itself stays queued and is dropped when a worker picks it up.
+ *
+ * Return: 0 on success, -EBUSY if it is running, -EALREADY if it is over.
+ */
+int32_t work_cancel(work_handle_t *h)
+{
+    if (!h)
+        return -EINVAL;
+
+    if (handle_finish(h, WORK_STATE_PENDING, WORK_STATE_CANCELED, \
+                      -ECANCELED))
+        return 0;
+
+    return atomic_load(&h->state) == WORK_STATE_RUNNING ? -EBUSY : -EALREADY;
+}
+
+/*
+ * work_wait - Wait for a tracked work to complete
+ * @timeout_ms: maximum wait, negative to wait forever
+ * @result:     optional, set to the handler return value once done
+ *
+ * Return: 0 when the work completed, -ECANCELED if it was cancelled or
+ * dropped, -ETIMEDOUT if it is still pending or running at timeout.
+ */
+int32_t work_wait(work_handle_t *h, int32_t timeout_ms, int32_t *result)
+{
+    struct timespec ts;
+    uint64_t deadline;
+    int32_t state, ret = 0;
+
+    if (!h)
+        return -EINVAL;
+
+    deadline = now_ns() + \
+               (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * NSEC_PER_MSEC;
+    ts.tv_sec = deadline / NSEC_PER_SEC;
+    ts.tv_nsec = deadline % NSEC_PER_SEC;
+
+    pthread_mutex_lock(&h->mutex);
+    while ((state = atomic_load(&h->state)) < WORK_STATE_DONE && \
+           ret != ETIMEDOUT) {
+        if (timeout_ms < 0)
+            pthread_cond_wait(&h->cond, &h->mutex);
+        else
+            ret = pthread_cond_timedwait(&h->cond, &h->mutex, &ts);
+    }
+    pthread_mutex_unlock(&h->mutex);
+
+    if (state == WORK_STATE_CANCELED)
+        return -ECANCELED;
+    if (state != WORK_STATE_DONE)
+        return -ETIMEDOUT;
+
+    if (result)
+        *result = h->result;
+    return 0;
+}
+
+void work_handle_put(work_handle_t *h)
+{
+    if (!h || atomic_fetch_sub(&h->refs, 1) != 1)
+        return;
+
+    pthread_mutex_destroy(&h->mutex);
+    pthread_cond_destroy(&h->cond);
+    obj_pool_free(&handle_pool, h);
+}
+
+/*
+ * work_handle_create - Handle completed by its producer, not by a work
+ * @cb:  optional, called once from the thread completing or cancelling it
+ * @arg: passed to @cb
+ *
+ * One reference is returned to the caller, the other belongs to the
+ * producer and is dropped by work_handle_complete(). Callers wait for and
+ * cancel it with the usual work_wait() and work_cancel().
+ */
+work_handle_t *work_handle_create(work_done_cb_t cb, void *arg)
+{
+    return create_handle(cb, arg);
+}
+
+/*
+ * work_handle_complete - Publish @result and drop the producer reference
+ *
+ * Return: false if the handle was cancelled first, @result is then dropped.
+ */
+bool work_handle_complete(work_handle_t *h, int32_t result)
+{
+    bool done;
+
+    done = handle_finish(h, WORK_STATE_PENDING, WORK_STATE_DONE, result);
+    work_handle_put(h);
+
+    return done;
+}
+
+/*
+ * work_begin - Claim a dequeued work before running its handler
+ *
+ * Return: false if the work was cancelled and must be skipped.
+ */
+bool work_begin(work_t *w)
+{
+    int32_t pending = WORK_STATE_PENDING;
+
+    if (!w->handle)
+        return true;
+
+    return atomic_compare_exchange_strong(&w->handle->state, &pending, \
+                                          WORK_STATE_RUNNING);
+}
+
+/*
+ * work_end - Publish the handler result of a work, or drop its handle
+ *
+ * Called with the handler result once it ran, and on release of a work
+ * that never ran, in which case the handle is marked cancelled. Drops the
+ * reference held by the work.
+ */
+void work_end(work_t *w, int32_t result)
+{
+    work_handle_t *h = w->handle;
+
+    if (!h)
+        return;
+
+    if (!handle_finish(h, WORK_STATE_RUNNING, WORK_STATE_DONE, result))
+        handle_finish(h, WORK_STATE_PENDING, WORK_STATE_CANCELED, \
+                      -ECANCELED);
+
+    w->handle = NULL;
+    work_handle_put(h);
+}
@@ -14,13 +14,23 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <pthread.h>
 #include <string.h>
 #include <signal.h>
 #include <stdatomic.h>
 #include <errno.h>
+#include <time.h>
+#if defined(WQ_LOCKLESS)
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
+#include "util.h"
 #include "comm/dbus_comm.h"
+#include "comm/cmd_payload.h"
+#include "mem/obj_pool.h"
 #include "sched/workqueue.h"
 #include "main.h"
 
@@ -39,10 +49,24 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void workqueue_destroy(workqueue_t *wq);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static const int32_t prio_weight[NR_WORK_PRIO] = {
+    [WORK_PRIO_LOW]                 = WQ_WEIGHT_LOW,
+    [WORK_PRIO_NORMAL]              = WQ_WEIGHT_NORMAL,
+    [WORK_PRIO_HIGH]                = WQ_WEIGHT_HIGH,
+    [WORK_PRIO_URGENT]              = WQ_WEIGHT_URGENT,
+};
+
+static obj_pool_t work_pool = OBJ_POOL_INITIALIZER("work", work_t);
+
+static const char *pool_name[NR_WORK_DURATION] = {
+    [WORK_DURATION_SHORT]           = "short",
+    [WORK_DURATION_LONG]            = "long",
+};
 
 /**********************
  *      MACROS
@@ -51,79 +75,508 @@
 /**********************
  *   STATIC FUNCTIONS
  **********************/
+static void refill_credit(wq_pool_t *pool)
+{
+    int32_t p;
+
+    for (p = 0; p < NR_WORK_PRIO; p++)
+        atomic_store(&pool->credit[p], prio_weight[p]);
+}
+
+/*
+ * Effective priority of a queued work item: the base priority raised by one
+ * level for every WQ_AGING_STEP_MS spent in the run queue. It is not capped
+ * at URGENT, so a LOW item overtakes URGENT work that has been waiting
+ * (URGENT - LOW) * WQ_AGING_STEP_MS less than itself.
+ */
+static int32_t effective_prio(int32_t prio, uint64_t enqueue_ns, uint64_t now)
+{
+    uint64_t waited_ms;
+
+    waited_ms = now > enqueue_ns ? (now - enqueue_ns) / NSEC_PER_MSEC : 0;
+    return prio + (int32_t)(waited_ms / WQ_AGING_STEP_MS);
+}
+
+#if defined(WQ_LOCKLESS)
+/*
+ * Lock-free backend: every run queue is a ring of work pointers stamped
+ * with their enqueue time. pool->mutex only protects the spill lists used
+ * while a ring is full, and idle workers sleep on a futex instead of the
+ * condition variable.
+ */
+static int32_t futex(atomic_uint *uaddr, int32_t op, uint32_t val)
+{
+    return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+static void pool_wake(wq_pool_t *pool, int32_t nr)
+{
+    atomic_fetch_add(&pool->wake_seq, 1);
+    if (atomic_load(&pool->nr_sleepers) > 0)
+        futex(&pool->wake_seq, FUTEX_WAKE_PRIVATE, nr);
+}
+
+static int32_t runq_backend_init(wq_pool_t *pool)
+{
+    int32_t p;
+
+    for (p = 0; p < NR_WORK_PRIO; p++) {
+        pool->ring[p] = ring_create(WQ_RING_SLOTS, sizeof(work_t *));
+        if (!pool->ring[p])
+            return -ENOMEM;
+        atomic_init(&pool->spilled[p], 0);
+    }
+
+    atomic_init(&pool->wake_seq, 0);
+    atomic_init(&pool->nr_sleepers, 0);
+    return 0;
+}
+
+static void runq_backend_destroy(wq_pool_t *pool)
+{
+    work_t *w;
+    int32_t p;
+
+    for (p = 0; p < NR_WORK_PRIO; p++) {
+        if (!pool->ring[p])
+            continue;
+
+        while (!ring_pop(pool->ring[p], &w))
+            delete_work(w);
+
+        ring_destroy(pool->ring[p]);
+        pool->ring[p] = NULL;
+    }
+}
+
+static bool runq_head_stamp(wq_pool_t *pool, int32_t p, uint64_t *stamp)
+{
+    work_t *head;
+    bool found = false;
+
+    if (!ring_peek_stamp(pool->ring[p], stamp))
+        return true;
+
+    if (atomic_load(&pool->spilled[p]) == 0)
+        return false;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (!list_empty(&pool->runq[p])) {
+        head = list_first_entry(&pool->runq[p], work_t, node);
+        *stamp = head->enqueue_ns;
+        found = true;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return found;
+}
+
+static bool runq_has_work(wq_pool_t *pool, int32_t p)
+{
+    return ring_count(pool->ring[p]) > 0 || \
+           atomic_load(&pool->spilled[p]) > 0;
+}
+
+static void runq_put(wq_pool_t *pool, work_t *w)
+{
+    int32_t p = w->prio;
+
+    /* Keep FIFO order: once spilled, new items queue behind the spill */
+    if (atomic_load(&pool->spilled[p]) == 0 && \
+        !ring_push_stamp(pool->ring[p], &w, w->enqueue_ns))
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    list_add_tail(&w->node, &pool->runq[p]);
+    atomic_fetch_add(&pool->spilled[p], 1);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static work_t *runq_take(wq_pool_t *pool, int32_t p)
+{
+    work_t *w = NULL;
+
+    if (!ring_pop(pool->ring[p], &w))
+        return w;
+
+    if (atomic_load(&pool->spilled[p]) == 0)
+        return NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (!list_empty(&pool->runq[p])) {
+        w = list_first_entry(&pool->runq[p], work_t, node);
+        list_del(&w->node);
+        atomic_fetch_sub(&pool->spilled[p], 1);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return w;
+}
+#else
+/* Mutex backend: plain lists, every helper runs with pool->mutex held */
+static int32_t runq_backend_init(wq_pool_t *pool __maybe_unused)
+{
+    return 0;
+}
+
+static void runq_backend_destroy(wq_pool_t *pool __maybe_unused)
+{
+}
+
+static bool runq_head_stamp(wq_pool_t *pool, int32_t p, uint64_t *stamp)
+{
+    if (list_empty(&pool->runq[p]))
+        return false;
+
+    *stamp = list_first_entry(&pool->runq[p], work_t, node)->enqueue_ns;
+    return true;
+}
+
+static bool runq_has_work(wq_pool_t *pool, int32_t p)
+{
+    return !list_empty(&pool->runq[p]);
+}
+
+static void runq_put(wq_pool_t *pool, work_t *w)
+{
+    list_add_tail(&w->node, &pool->runq[w->prio]);
+}
+
+static work_t *runq_take(wq_pool_t *pool, int32_t p)
+{
+    work_t *w;
+
+    if (list_empty(&pool->runq[p]))
+        return NULL;
+
+    w = list_first_entry(&pool->runq[p], work_t, node);
+    list_del(&w->node);
+
+    return w;
+}
+#endif /* WQ_LOCKLESS */
+
+/*
+ * Strict mode: serve the queue whose head has the highest effective
+ * priority. Only heads are compared, each run queue is FIFO so its head is
+ * always the oldest item. On a tie the higher base priority wins.
+ */
+static int32_t select_runq_strict(wq_pool_t *pool)
+{
+    int32_t p, eff, best = -1, best_eff = -1;
+    uint64_t now = now_ns();
+    uint64_t stamp;
+
+    for (p = WORK_PRIO_URGENT; p >= WORK_PRIO_LOW; p--) {
+        if (!runq_head_stamp(pool, p, &stamp))
+            continue;
+
+        eff = effective_prio(p, stamp, now);
+        if (eff > best_eff) {
+            best = p;
+            best_eff = eff;
+        }
+    }
+
+    return best;
+}
+
+/*
+ * Weighted mode: every priority may dequeue up to its weight per round,
+ * higher priorities first. The round restarts once no non-empty queue has
+ * credit left, so every priority is guaranteed a share of the workers.
+ */
+static int32_t select_runq_weighted(wq_pool_t *pool)
+{
+    int32_t p, round;
+
+    for (round = 0; round < 2; round++) {
+        for (p = WORK_PRIO_URGENT; p >= WORK_PRIO_LOW; p--) {
+            if (!runq_has_work(pool, p) || \
+                atomic_fetch_sub(&pool->credit[p], 1) <= 0)
+                continue;
+
+            return p;
+        }
+
+        refill_credit(pool);
+    }
+
+    return -1;
+}
+
+static work_t *dequeue_work(wq_pool_t *pool)
+{
+    work_t *w = NULL;
+    int32_t p, tries;
+
+    /* Lock-free consumers may lose the selected item to another worker */
+    for (tries = 0; tries < NR_WORK_PRIO && !w; tries++) {
+        if (pool->policy == WQ_POLICY_WEIGHTED)
+            p = select_runq_weighted(pool);
+        else
+            p = select_runq_strict(pool);
+
+        if (p < 0)
+            return NULL;
+
+        w = runq_take(pool, p);
+    }
+
+    /* Still contended, take whatever is left from the highest priority */
+    for (p = WORK_PRIO_URGENT; p >= WORK_PRIO_LOW && !w; p--)
+        w = runq_take(pool, p);
+
+    return w;
+}
+
+static bool runq_empty(wq_pool_t *pool)
+{
+    int32_t p;
+
+    for (p = 0; p < NR_WORK_PRIO; p++) {
+        if (runq_has_work(pool, p))
+            return false;
+    }
+
+    return true;
+}
+
+static void account_push(workqueue_t *wq, int32_t nr)
+{
+    int32_t depth, peak;
+
+    depth = atomic_fetch_add(&wq->active_cnt, nr) + nr;
+    peak = atomic_load(&wq->peak_cnt);
+    while (depth > peak && \
+           !atomic_compare_exchange_weak(&wq->peak_cnt, &peak, depth))
+        ;
+}
+
+/*
+ * A dequeued coalescable work leaves the pending table before its data is
+ * looked at, a later duplicate is then queued instead of merged into it.
+ * Only the consumer unlinks, and the node was linked before the push that
+ * made the work visible, so the unlocked check is safe.
+ */
+static void unlink_pending(workqueue_t *wq, work_t *w)
+{
+    if (list_empty(&w->pend_node))
+        return;
+
+    pthread_mutex_lock(&wq->pend_lock);
+    list_del_init(&w->pend_node);
+    pthread_mutex_unlock(&wq->pend_lock);
+}
+
+/*
+ * Hand the payload of @w to a pending work of the same type, opcode and
+ * @key, taking the stale payload back. Called with pend_lock held.
+ */
+static bool coalesce_pending(workqueue_t *wq, work_t *w, uint32_t key)
+{
+    work_t *pos;
+    void *stale;
+
+    list_for_each_entry(pos, &wq->pending, pend_node) {
+        if (pos->type != w->type || pos->opcode != w->opcode || \
+            pos->coalesce_key != key)
+            continue;
+
+        stale = pos->data;
+        pos->data = w->data;
+        w->data = stale;
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Long work falls back to the short pool when no long worker is configured,
+ * so it is still served, only without the isolation.
+ */
+static wq_pool_t *select_pool(workqueue_t *wq, const work_t *w)
+{
+    wq_pool_t *pool = &wq->pool[WORK_DURATION_LONG];
+
+    if (w->duration == WORK_DURATION_LONG && pool->nr_workers > 0)
+        return pool;
+
+    return &wq->pool[WORK_DURATION_SHORT];
+}
+
+static int32_t pool_init(workqueue_t *wq, wq_pool_t *pool, \
+                         work_duration_t duration)
+{
+    int32_t p;
+
+    pool->wq = wq;
+    pool->duration = duration;
+    for (p = 0; p < NR_WORK_PRIO; p++)
+        INIT_LIST_HEAD(&pool->runq[p]);
+
+    pool->policy = WQ_DEFAULT_POLICY;
+    refill_credit(pool);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pool->workers = NULL;
+    pool->nr_workers = 0;
+
+    return runq_backend_init(pool);
+}
+
+static void pool_destroy(wq_pool_t *pool)
+{
+    work_t *pos, *n;
+    int32_t p;
+
+    runq_backend_destroy(pool);
+
+    pthread_mutex_lock(&pool->mutex);
+    for (p = 0; p < NR_WORK_PRIO; p++) {
+        list_for_each_entry_safe(pos, n, &pool->runq[p], node) {
+            list_del(&pos->node);
+            delete_work(pos);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+    free(pool->workers);
+    pool->workers = NULL;
+}
+
 static workqueue_t *workqueue_create(void)
 {
+    pthread_condattr_t attr;
     workqueue_t *wq;
+    int32_t d, ret = 0;
 
     wq = calloc(1, sizeof(*wq));
     if (!wq)
         return NULL;
 
-    INIT_LIST_HEAD(&wq->list);
+    for (d = 0; d < NR_WORK_DURATION; d++)
+        ret |= pool_init(wq, &wq->pool[d], d);
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
     pthread_mutex_init(&wq->mutex, NULL);
-    pthread_cond_init(&wq->cond, NULL);
+    pthread_cond_init(&wq->cond, &attr);
+    pthread_condattr_destroy(&attr);
     atomic_store(&wq->active_cnt, 0);
+    atomic_store(&wq->peak_cnt, 0);
+    pthread_mutex_init(&wq->pend_lock, NULL);
+    INIT_LIST_HEAD(&wq->pending);
+
+    if (ret) {
+        workqueue_destroy(wq);
+        return NULL;
+    }
 
     return wq;
 }
 
 static void workqueue_destroy(workqueue_t *wq)
 {
-    work_t *pos, *n;
+    int32_t d;
 
     if (wq == NULL) {
         LOG_ERROR("Workqueue data is invalid");
         return;
-    } 
-
-    pthread_mutex_lock(&wq->mutex);
-    list_for_each_entry_safe(pos, n, &wq->list, node) {
-        list_del(&pos->node);
-        free(pos->data);
-        free(pos);
     }
-    pthread_mutex_unlock(&wq->mutex);
+
+    for (d = 0; d < NR_WORK_DURATION; d++)
+        pool_destroy(&wq->pool[d]);
 
     pthread_mutex_destroy(&wq->mutex);
     pthread_cond_destroy(&wq->cond);
+    pthread_mutex_destroy(&wq->pend_lock);
     free(wq);
 }
 
-static int32_t create_workers(wq_ctx_t *ctx)
+static int32_t create_workers(wq_pool_t *pool, int32_t nr_workers)
 {
     int32_t i, ret;
 
-    ctx->nr_workers = 0;
+    pool->nr_workers = 0;
+    if (nr_workers <= 0)
+        return 0;
 
-    for (i = 0; i < WORKERS_PER_QUEUE; i++) {
-        ret = pthread_create(&ctx->workers[i], NULL,
-                             workqueue_handler, ctx->wq);
+    pool->workers = calloc(nr_workers, sizeof(*pool->workers));
+    if (!pool->workers)
+        return -ENOMEM;
+
+    for (i = 0; i < nr_workers; i++) {
+        ret = pthread_create(&pool->workers[i], NULL,
+                             workqueue_handler, pool);
         if (ret) {
             LOG_FATAL("Failed to create worker thread: %s", strerror(ret));
             return -ENOMEM;
         }
 
-        ctx->nr_workers++;
-        LOG_TRACE("Worker %d created", i);
+        pool->nr_workers++;
+        LOG_TRACE("Worker %d of %s pool created", i, pool_name[pool->duration]);
     }
 
     return 0;
 }
 
+static void join_workers(workqueue_t *wq)
+{
+    wq_pool_t *pool;
+    int32_t d, w;
+
+    for (d = 0; d < NR_WORK_DURATION; d++) {
+        pool = &wq->pool[d];
+        for (w = 0; w < pool->nr_workers; w++) {
+            pthread_join(pool->workers[w], NULL);
+            LOG_TRACE("%s pool - Worker %d: Exited", pool_name[d], w);
+        }
+        pool->nr_workers = 0;
+    }
+}
+
 static void rollback_workqueues(int32_t upto)
 {
-    int32_t i, w;
+    int32_t i;
     wq_ctx_t *wq_ctxs = get_ctx()->wqs;
 
-    for (i = 0; i < upto; i++) {
-        for (w = 0; w < wq_ctxs[i].nr_workers; w++)
-            pthread_join(wq_ctxs[i].workers[w], NULL);
+    /* Workers only exit their loop once the service stops running */
+    get_ctx()->run = 0;
 
+    for (i = 0; i < upto; i++) {
+        workqueue_handler_wakeup(wq_ctxs[i].wq);
+        join_workers(wq_ctxs[i].wq);
         workqueue_destroy(wq_ctxs[i].wq);
     }
 
     free(wq_ctxs);
-    wq_ctxs = NULL;
+    get_ctx()->wqs = NULL;
+    get_ctx()->nr_wqs = 0;
+}
+
+static int32_t conf_from_env(const char *name, int32_t def, \
+                             int32_t min, int32_t max)
+{
+    const char *str;
+    char *end;
+    long val;
+
+    str = getenv(name);
+    if (!str || !*str)
+        return def;
+
+    val = strtol(str, &end, 10);
+    if (*end != '\0' || val < min || val > max) {
+        LOG_WARN("Ignore %s=%s, expected a value in [%d, %d]", \
+                 name, str, min, max);
+        return def;
+    }
+
+    return (int32_t)val;
 }
 /**********************
  *   GLOBAL FUNCTIONS
@@ -133,58 +586,235 @@ work_t *create_work(uint8_t type, uint8_t priority, uint8_t duration, \
 {
     work_t *w;
 
-    w = calloc(1, sizeof(*w));
+    w = obj_pool_zalloc(&work_pool);
     if (!w)
         return NULL;
 
     w->type = type;
-    w->prio = priority;
-    w->duration = duration;
+    w->prio = priority < NR_WORK_PRIO ? priority : WORK_PRIO_URGENT;
+    w->duration = duration < NR_WORK_DURATION ? duration : WORK_DURATION_LONG;
     w->opcode = opcode;
     w->data = data;
     INIT_LIST_HEAD(&w->node);
+    INIT_LIST_HEAD(&w->pend_node);
 
     LOG_TRACE("Created work for opcode: %d", w->opcode);
     return w;
 }
 
+/* Release the payload according to the work type, then the work itself */
+void delete_work(work_t *w)
+{
+    if (!w)
+        return;
+
+    /* A tracked work released before it ran reports as cancelled */
+    work_end(w, -ECANCELED);
+
+    if (w->data) {
+        if (w->type == WORK_TYPE_REMOTE)
+            delete_remote_cmd(w->data);
+        else
+            delete_local_cmd(w->data);
+    }
+
+    obj_pool_free(&work_pool, w);
+}
+
 void push_work(workqueue_t *wq, work_t *w)
 {
+    wq_pool_t *pool;
+
     if (wq == NULL || w == NULL) {
         LOG_ERROR("Workqueue data is invalid");
         return;
-    } 
+    }
 
-    pthread_mutex_lock(&wq->mutex);
-    list_add_tail(&w->node, &wq->list);
-    atomic_fetch_add(&wq->active_cnt, 1);
-    pthread_cond_signal(&wq->cond);
-    pthread_mutex_unlock(&wq->mutex);
+    pool = select_pool(wq, w);
+    w->enqueue_ns = now_ns();
+    account_push(wq, 1);
+
+#if defined(WQ_LOCKLESS)
+    runq_put(pool, w);
+    pool_wake(pool, 1);
+#else
+    pthread_mutex_lock(&pool->mutex);
+    runq_put(pool, w);
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+#endif
 }
 
-work_t *pop_work_wait_safe(workqueue_t *wq)
+/*
+ * push_work_batch - Queue @nr works at once
+ *
+ * Same as calling push_work() for each of them, but every pool involved is
+ * locked and signaled once for the whole batch. Order is kept within each
+ * pool. NULL entries are skipped.
+ */
+void push_work_batch(workqueue_t *wq, work_t **works, int32_t nr)
 {
-    work_t *w = NULL;
+    int32_t i, d, cnt[NR_WORK_DURATION] = { 0 }, total = 0;
+    wq_pool_t *pool;
+    uint64_t now;
 
-    if (wq == NULL) {
+    if (wq == NULL || works == NULL || nr <= 0) {
         LOG_ERROR("Workqueue data is invalid");
-        return NULL;
-    } 
+        return;
+    }
 
-    pthread_mutex_lock(&wq->mutex);
-    while (list_empty(&wq->list) && get_ctx()->run)
-        pthread_cond_wait(&wq->cond, &wq->mutex);
+    now = now_ns();
+    for (i = 0; i < nr; i++) {
+        if (!works[i])
+            continue;
 
-    if (list_empty(&wq->list)) {
-        pthread_mutex_unlock(&wq->mutex);
+        works[i]->enqueue_ns = now;
+        cnt[select_pool(wq, works[i])->duration]++;
+        total++;
+    }
+
+    if (!total)
+        return;
+    account_push(wq, total);
+
+    for (d = 0; d < NR_WORK_DURATION; d++) {
+        if (!cnt[d])
+            continue;
+
+        pool = &wq->pool[d];
+#if defined(WQ_LOCKLESS)
+        for (i = 0; i < nr; i++) {
+            if (works[i] && select_pool(wq, works[i]) == pool)
+                runq_put(pool, works[i]);
+        }
+        pool_wake(pool, cnt[d]);
+#else
+        pthread_mutex_lock(&pool->mutex);
+        for (i = 0; i < nr; i++) {
+            if (works[i] && select_pool(wq, works[i]) == pool)
+                runq_put(pool, works[i]);
+        }
+
+        if (cnt[d] > 1)
+            pthread_cond_broadcast(&pool->cond);
+        else
+            pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+#endif
+    }
+
+    LOG_TRACE("Pushed a batch of %d works", total);
+}
+
+/*
+ * push_work_coalesce - Queue @w unless an equivalent work is still pending
+ * @key: payload key refining the match, 0 when the opcode alone is enough
+ *
+ * A pending work of the same type, opcode and key keeps its place in the
+ * run queue and takes over the payload of @w, then @w and the stale payload
+ * are released. Meant for state reports where only the newest one matters,
+ * it bounds the queue depth to one item per key.
+ *
+ * Return: 1 when @w replaced a pending work, 0 when it was queued,
+ * -EINVAL on invalid arguments.
+ */
+int32_t push_work_coalesce(workqueue_t *wq, work_t *w, uint32_t key)
+{
+    if (wq == NULL || w == NULL) {
+        LOG_ERROR("Workqueue data is invalid");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&wq->pend_lock);
+    if (coalesce_pending(wq, w, key)) {
+        pthread_mutex_unlock(&wq->pend_lock);
+
+        LOG_TRACE("Coalesced work for opcode: %d, key %u", w->opcode, key);
+        delete_work(w);
+        return 1;
+    }
+
+    w->coalesce_key = key;
+    list_add_tail(&w->pend_node, &wq->pending);
+    pthread_mutex_unlock(&wq->pend_lock);
+
+    push_work(wq, w);
+    return 0;
+}
+
+/*
+ * replace_pending_work - Merge @w into an equivalent pending work only
+ *
+ * Same as push_work_coalesce(), except that @w is left to the caller when
+ * there is nothing to replace. Lets a backed up queue still take the
+ * newest report without growing.
+ *
+ * Return: 1 when @w replaced a pending work and was released, 0 when no
+ * pending work matched, -EINVAL on invalid arguments.
+ */
+int32_t replace_pending_work(workqueue_t *wq, work_t *w, uint32_t key)
+{
+    bool replaced;
+
+    if (wq == NULL || w == NULL) {
+        LOG_ERROR("Workqueue data is invalid");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&wq->pend_lock);
+    replaced = coalesce_pending(wq, w, key);
+    pthread_mutex_unlock(&wq->pend_lock);
+
+    if (!replaced)
+        return 0;
+
+    LOG_TRACE("Replaced pending work for opcode: %d, key %u", w->opcode, key);
+    delete_work(w);
+    return 1;
+}
+
+work_t *pop_work_wait_safe(wq_pool_t *pool)
+{
+    work_t *w = NULL;
+
+    if (pool == NULL) {
+        LOG_ERROR("Workqueue data is invalid");
         return NULL;
     }
 
-    w = list_first_entry(&wq->list, work_t, node);
-    list_del(&w->node);
+#if defined(WQ_LOCKLESS)
+    uint32_t seq;
+
+    for (;;) {
+        w = dequeue_work(pool);
+        if (w)
+            unlink_pending(pool->wq, w);
+        if (w || !get_ctx()->run)
+            return w;
+
+        /*
+         * Announce the sleep before checking the queues again, a producer
+         * either sees the sleeper and wakes it, or its item is visible to
+         * the second check. The futex returns at once if wake_seq moved.
+         */
+        seq = atomic_load(&pool->wake_seq);
+        atomic_fetch_add(&pool->nr_sleepers, 1);
+        if (runq_empty(pool) && get_ctx()->run)
+            futex(&pool->wake_seq, FUTEX_WAIT_PRIVATE, seq);
+        atomic_fetch_sub(&pool->nr_sleepers, 1);
+    }
+#else
+    pthread_mutex_lock(&pool->mutex);
+    while (runq_empty(pool) && get_ctx()->run)
+        pthread_cond_wait(&pool->cond, &pool->mutex);
 
-    pthread_mutex_unlock(&wq->mutex);
+    w = dequeue_work(pool);
+    if (w)
+        unlink_pending(pool->wq, w);
+
+    pthread_mutex_unlock(&pool->mutex);
     return w;
+#endif
 }
 
 void workqueue_complete_work(workqueue_t *wq, work_t *w)
@@ -192,14 +822,12 @@ void workqueue_complete_work(workqueue_t *wq, work_t *w)
     if (wq == NULL || w == NULL) {
         LOG_ERROR("Workqueue data is invalid");
         return;
-    } 
+    }
 
-    if (w->data)
-        free(w->data);
-    free(w);
+    delete_work(w);
 
-    atomic_fetch_sub(&wq->active_cnt, 1);
-    if (atomic_load(&wq->active_cnt) == 0) {
+    /* Only the completion that drains the queue notifies waiters */
+    if (atomic_fetch_sub(&wq->active_cnt, 1) == 1) {
         pthread_mutex_lock(&wq->mutex);
         pthread_cond_broadcast(&wq->cond);
         pthread_mutex_unlock(&wq->mutex);
@@ -208,10 +836,23 @@ void workqueue_complete_work(workqueue_t *wq, work_t *w)
 
 void workqueue_handler_wakeup(workqueue_t *wq)
 {
+    wq_pool_t *pool;
+    int32_t d;
+
     if (wq == NULL) {
         LOG_ERROR("Workqueue data is invalid");
         return;
-    } 
+    }
+
+    for (d = 0; d < NR_WORK_DURATION; d++) {
+        pool = &wq->pool[d];
+#if defined(WQ_LOCKLESS)
+        pool_wake(pool, INT32_MAX);
+#endif
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
 
     pthread_mutex_lock(&wq->mutex);
     pthread_cond_broadcast(&wq->cond);
@@ -222,7 +863,7 @@ int32_t workqueue_handler_wakeup_all(void)
 {
     int32_t i;
 
-    for (i = 0; i < NR_WORKQUEUE; i++) {
+    for (i = 0; i < get_nr_wq(); i++) {
         workqueue_handler_wakeup(get_wq(i));
         LOG_TRACE("WQ %d wakeup all handler", i);
     }
@@ -235,52 +876,136 @@ int32_t workqueue_active_count(workqueue_t *wq)
     if (wq == NULL) {
         LOG_ERROR("Workqueue data is invalid");
         return -EINVAL;
-    } 
+    }
     return atomic_load(&wq->active_cnt);
 }
 
+/*
+ * workqueue_drain - Wait until every work pushed to @wq has completed
+ * @timeout_ms: maximum wait, negative to wait forever
+ *
+ * Return: 0 once drained, -ETIMEDOUT if work is still pending at timeout.
+ */
+int32_t workqueue_drain(workqueue_t *wq, int32_t timeout_ms)
+{
+    struct timespec ts;
+    uint64_t deadline;
+    int32_t ret = 0;
+
+    if (wq == NULL) {
+        LOG_ERROR("Workqueue data is invalid");
+        return -EINVAL;
+    }
+
+    deadline = now_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * \
+               NSEC_PER_MSEC;
+    ts.tv_sec = deadline / NSEC_PER_SEC;
+    ts.tv_nsec = deadline % NSEC_PER_SEC;
+
+    pthread_mutex_lock(&wq->mutex);
+    while (atomic_load(&wq->active_cnt) > 0 && ret != ETIMEDOUT) {
+        if (timeout_ms < 0)
+            pthread_cond_wait(&wq->cond, &wq->mutex);
+        else
+            ret = pthread_cond_timedwait(&wq->cond, &wq->mutex, &ts);
+    }
+    pthread_mutex_unlock(&wq->mutex);
+
+    return atomic_load(&wq->active_cnt) > 0 ? -ETIMEDOUT : 0;
+}
+
+int32_t workqueue_set_policy(workqueue_t *wq, wq_policy_t policy)
+{
+    wq_pool_t *pool;
+    int32_t d;
+
+    if (wq == NULL) {
+        LOG_ERROR("Workqueue data is invalid");
+        return -EINVAL;
+    }
+
+    if (policy != WQ_POLICY_STRICT && policy != WQ_POLICY_WEIGHTED)
+        return -EINVAL;
+
+    for (d = 0; d < NR_WORK_DURATION; d++) {
+        pool = &wq->pool[d];
+        pthread_mutex_lock(&pool->mutex);
+        pool->policy = policy;
+        refill_credit(pool);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    return 0;
+}
+
 workqueue_t *get_wq(int32_t index)
 {
     wq_ctx_t *wq_ctxs = get_ctx()->wqs;
 
-    if (index > NR_WORKQUEUE) {
+    if (!wq_ctxs || index < 0 || index >= get_nr_wq()) {
         LOG_ERROR("Workqueue data is invalid");
         return NULL;
     }
-        
+
     return wq_ctxs[index].wq;
 }
 
-static inline void set_wq(workqueue_t *wq, int32_t index)
+int32_t get_nr_wq(void)
 {
-    wq_ctx_t *wq_ctxs = get_ctx()->wqs;
+    return get_ctx()->nr_wqs;
+}
 
-    if (wq == NULL) {
-        LOG_ERROR("Workqueue data is invalid");
+/*
+ * Fill @conf with the compiled-in defaults, then apply any override given
+ * through the TERMINAL_UI_WQ_* environment variables.
+ */
+void workqueue_default_conf(wq_conf_t *conf)
+{
+    if (!conf)
         return;
-    } 
 
-    wq_ctxs[index].wq = wq;
+    conf->nr_queues = conf_from_env(WQ_ENV_NR_QUEUES, \
+                                    WQ_DEFAULT_NR_QUEUES, 1, WQ_MAX_QUEUES);
+    conf->nr_workers[WORK_DURATION_SHORT] = \
+        conf_from_env(WQ_ENV_SHORT_WORKERS, WQ_DEFAULT_SHORT_WORKERS, \
+                      1, WQ_MAX_WORKERS);
+    conf->nr_workers[WORK_DURATION_LONG] = \
+        conf_from_env(WQ_ENV_LONG_WORKERS, WQ_DEFAULT_LONG_WORKERS, \
+                      0, WQ_MAX_WORKERS);
 }
 
-int32_t workqueue_init(void)
+int32_t workqueue_init(const wq_conf_t *conf)
 {
-    int32_t i, ret;
+    int32_t i, d, ret;
     workqueue_t *wq = NULL;
     wq_ctx_t *ctx = NULL;
+    wq_conf_t def_conf;
 
-    ctx = calloc(NR_WORKQUEUE, sizeof(*ctx));
+    if (!conf) {
+        workqueue_default_conf(&def_conf);
+        conf = &def_conf;
+    }
+
+    if (conf->nr_queues <= 0 || conf->nr_queues > WQ_MAX_QUEUES || \
+        conf->nr_workers[WORK_DURATION_SHORT] <= 0) {
+        LOG_FATAL("Invalid workqueue configuration");
+        return -EINVAL;
+    }
+
+    ctx = calloc(conf->nr_queues, sizeof(*ctx));
     if (!ctx) {
-        LOG_FATAL("Unable to allocate %d workqueue contexts", NR_WORKQUEUE);
+        LOG_FATAL("Unable to allocate %d workqueue contexts", conf->nr_queues);
         return -ENOMEM;
     }
 
-    LOG_INFO("Init %d workers per workqueue, total %d workqueues",
-             WORKERS_PER_QUEUE, NR_WORKQUEUE);
+    LOG_INFO("Init %d short + %d long workers per workqueue, " \
+             "total %d workqueues", conf->nr_workers[WORK_DURATION_SHORT], \
+             conf->nr_workers[WORK_DURATION_LONG], conf->nr_queues);
 
     get_ctx()->wqs = ctx;
+    get_ctx()->nr_wqs = conf->nr_queues;
 
-    for (i = 0; i < NR_WORKQUEUE; i++) {
+    for (i = 0; i < conf->nr_queues; i++) {
         wq = workqueue_create();
         if (!wq) {
             LOG_FATAL("Unable to create workqueue, index %d", i);
@@ -291,21 +1016,29 @@ int32_t workqueue_init(void)
         ctx[i].wq = wq;
         LOG_TRACE("Workqueue %d created", i);
 
-        ret = create_workers(&ctx[i]);
-        if (ret) {
-            if (NR_WORKQUEUE > 1)
-                LOG_ERROR("Failed to create %d workers for queue %d",
-                          WORKERS_PER_QUEUE, i);
-            else
-                LOG_FATAL("Failed to create %d workers for queue %d",
-                          WORKERS_PER_QUEUE, i);
-
-            rollback_workqueues(i + 1);
-            return -ENOMEM;
+        for (d = 0; d < NR_WORK_DURATION; d++) {
+            ret = create_workers(&wq->pool[d], conf->nr_workers[d]);
+            if (ret) {
+                if (conf->nr_queues > 1)
+                    LOG_ERROR("Failed to create %d %s workers for queue %d",
+                              conf->nr_workers[d], pool_name[d], i);
+                else
+                    LOG_FATAL("Failed to create %d %s workers for queue %d",
+                              conf->nr_workers[d], pool_name[d], i);
+
+                rollback_workqueues(i + 1);
+                return -ENOMEM;
+            }
+
+            LOG_TRACE("Created %d %s workers for queue %d",
+                      conf->nr_workers[d], pool_name[d], i);
         }
+    }
 
-        LOG_TRACE("Created %d workers for queue %d",
-                  WORKERS_PER_QUEUE, i);
+    ret = wq_timer_init();
+    if (ret) {
+        rollback_workqueues(conf->nr_queues);
+        return ret;
     }
 
     return 0;
@@ -313,21 +1046,20 @@ int32_t workqueue_init(void)
 
 void workqueue_deinit(void)
 {
-    int32_t i, w;
+    int32_t i;
     wq_ctx_t *wq_ctxs = get_ctx()->wqs;
 
+    /* Timers push into the workqueues, stop them first */
+    wq_timer_deinit();
     workqueue_handler_wakeup_all();
 
-    for (i = 0; i < NR_WORKQUEUE; i++) {
-        for (w = 0; w < wq_ctxs[i].nr_workers; w++) {
-            pthread_join(wq_ctxs[i].workers[w], NULL);
-            LOG_TRACE("WQ %d - Worker %d: Exited", i, w);
-        }
-
-        workqueue_destroy(get_wq(i));
+    for (i = 0; i < get_nr_wq(); i++) {
+        join_workers(wq_ctxs[i].wq);
+        workqueue_destroy(wq_ctxs[i].wq);
         LOG_TRACE("WQ %d destroyed", i);
     }
 
     free(wq_ctxs);
     get_ctx()->wqs = NULL;
+    get_ctx()->nr_wqs = 0;
 }
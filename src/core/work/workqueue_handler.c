@@ -22,6 +22,7 @@
 
 #include "comm/dbus_comm.h"
 #include "sched/workqueue.h"
+#include "sched/wq_stats.h"
 #include "main.h"
 
 /*********************
@@ -61,14 +62,18 @@ void *workqueue_handler(void* arg)
     int32_t ret = 0;
     pthread_t tid = pthread_self();
     workqueue_t *wq = NULL;
+    wq_pool_t *pool = NULL;
 
-    wq = (workqueue_t *)arg;
-    if (wq == NULL) {
+    pool = (wq_pool_t *)arg;
+    if (pool == NULL || pool->wq == NULL) {
         LOG_FATAL("Workqueue handler unable to get workqueue");
         return NULL;
     }
+    wq = pool->wq;
 
-    LOG_INFO("Workqueue handler started - thread ID: %lu", (unsigned long)tid);
+    LOG_INFO("Workqueue handler started - thread ID: %lu - %s work", \
+             (unsigned long)tid, \
+             pool->duration == WORK_DURATION_LONG ? "long" : "short");
 
     // LOG_INFO("Task handler is running...");
     while (get_ctx()->run) {
@@ -76,7 +81,7 @@ void *workqueue_handler(void* arg)
         // usleep(200000);
         LOG_TRACE("Workqueue handler ID [%lu] --> waiting for new task...", \
                   (unsigned long)tid);
-        w = pop_work_wait_safe(wq);
+        w = pop_work_wait_safe(pool);
         /*
          * After a work item is popped from the workqueue, it is no longer
          * linked to the work list. This means:
@@ -105,18 +110,25 @@ void *workqueue_handler(void* arg)
                      w->opcode, w->prio , w->duration);
 
             workqueue_complete_work(wq, w);
+        } else if (!work_begin(w)) {
+            LOG_TRACE("Handler ID [%lu] skip cancelled opcode [%d]", \
+                      (unsigned long)tid, w->opcode);
+            workqueue_complete_work(wq, w);
         } else {
             /*
              * Run blocking task; return after it completes other tasks in
              * queue wait until it's done. or will be handled by another handler
              */
 
+            wq_stats_work_start(w);
             ret = process_opcode(w->opcode, w->data);
+            wq_stats_work_done(w);
             if (ret) {
                 LOG_ERROR("Handler ID [%lu] task failed with ret=%d\n" \
                           "\tType: [%d] - priority [%d] - opcode [%d]", \
                           (unsigned long)tid, ret, w->type, w->prio, w->opcode);
             }
+            work_end(w, ret);
             // The working data structures for any tasks need to be freed
             workqueue_complete_work(wq, w);
         }
@@ -0,0 +1,216 @@
+/**
+ * @file wq_stats.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "util.h"
+#include "comm/cmd_payload.h"
+#include "sched/workqueue.h"
+#include "sched/wq_stats.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/* Indexed by opcode, out of range opcodes are accounted as OP_NONE */
+static wq_hist_t op_hist[OP_ID_END][NR_WQ_HIST];
+
+static const char *hist_name[NR_WQ_HIST] = {
+    [WQ_HIST_WAIT]                  = "wait",
+    [WQ_HIST_SERVICE]               = "service",
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static int32_t hist_index(uint64_t us)
+{
+    int32_t msb;
+
+    if (us < WQ_HIST_SUB)
+        return (int32_t)us;
+
+    msb = 63 - __builtin_clzll(us);
+    if (msb > WQ_HIST_MAX_MSB)
+        return WQ_HIST_BUCKETS - 1;
+
+    return (msb - WQ_HIST_SUB_BITS + 1) * WQ_HIST_SUB + \
+           (int32_t)((us >> (msb - WQ_HIST_SUB_BITS)) & (WQ_HIST_SUB - 1));
+}
+
+/* Highest value counted in bucket @idx */
+static uint32_t hist_bucket_max(int32_t idx)
+{
+    int32_t shift;
+
+    if (idx < WQ_HIST_SUB)
+        return (uint32_t)idx;
+
+    shift = idx / WQ_HIST_SUB - 1;
+    return (((uint32_t)(WQ_HIST_SUB + idx % WQ_HIST_SUB) + 1) << shift) - 1;
+}
+
+static wq_hist_t *op_hists(uint32_t opcode)
+{
+    return op_hist[opcode < OP_ID_END ? opcode : OP_NONE];
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * wq_hist_record - Account a duration of @ns in @h
+ *
+ * Lock-free: concurrent workers only contend on the counters they touch.
+ */
+void wq_hist_record(wq_hist_t *h, uint64_t ns)
+{
+    uint64_t us = ns / NSEC_PER_USEC;
+    uint32_t max, val = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+
+    atomic_fetch_add_explicit(&h->bucket[hist_index(us)], 1, \
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_us, us, memory_order_relaxed);
+
+    max = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+    while (val > max && \
+           !atomic_compare_exchange_weak_explicit(&h->max_us, &max, val, \
+                                                  memory_order_relaxed, \
+                                                  memory_order_relaxed))
+        ;
+}
+
+/*
+ * wq_hist_percentile - Upper bound of the @pct percentile of @h, in us
+ *
+ * Return: 0 when nothing was recorded.
+ */
+uint32_t wq_hist_percentile(const wq_hist_t *h, double pct)
+{
+    uint64_t target, seen = 0;
+    uint32_t count, max;
+    int32_t i;
+
+    count = atomic_load(&h->count);
+    if (!count)
+        return 0;
+
+    target = (uint64_t)(count * pct / 100.0);
+    if (target >= count)
+        target = count - 1;
+
+    max = atomic_load(&h->max_us);
+    for (i = 0; i < WQ_HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->bucket[i], memory_order_relaxed);
+        if (seen > target)
+            return hist_bucket_max(i) < max ? hist_bucket_max(i) : max;
+    }
+
+    return max;
+}
+
+/* Wait or service time histogram of @opcode, shared and still updated */
+const wq_hist_t *wq_stats_hist(uint32_t opcode, wq_hist_type_t type)
+{
+    return &op_hists(opcode)[type < NR_WQ_HIST ? type : WQ_HIST_WAIT];
+}
+
+/* Called by the worker right before the handler of @w runs */
+void wq_stats_work_start(work_t *w)
+{
+    w->start_ns = now_ns();
+    wq_hist_record(&op_hists(w->opcode)[WQ_HIST_WAIT], \
+                w->start_ns > w->enqueue_ns ? w->start_ns - w->enqueue_ns : 0);
+}
+
+/* Called by the worker once the handler of @w returned */
+void wq_stats_work_done(work_t *w)
+{
+    w->end_ns = now_ns();
+    wq_hist_record(&op_hists(w->opcode)[WQ_HIST_SERVICE], \
+                w->end_ns > w->start_ns ? w->end_ns - w->start_ns : 0);
+}
+
+void wq_stats_reset(void)
+{
+    wq_hist_t *h;
+    int32_t op, t, i;
+
+    for (op = 0; op < OP_ID_END; op++) {
+        for (t = 0; t < NR_WQ_HIST; t++) {
+            h = &op_hist[op][t];
+            for (i = 0; i < WQ_HIST_BUCKETS; i++)
+                atomic_store(&h->bucket[i], 0);
+            atomic_store(&h->count, 0);
+            atomic_store(&h->sum_us, 0);
+            atomic_store(&h->max_us, 0);
+        }
+    }
+}
+
+/*
+ * Log the queue depth of every workqueue, then the wait and service time
+ * distribution of every opcode seen so far. All times are in us.
+ */
+void wq_stats_dump(void)
+{
+    workqueue_t *wq __maybe_unused;         /* Only read by LOG_INFO */
+    wq_hist_t *h;
+    uint32_t count;
+    int32_t i, op, t;
+
+    for (i = 0; i < get_nr_wq(); i++) {
+        wq = get_wq(i);
+        LOG_INFO("WQ %d: active %d, peak depth %d", i, \
+                 atomic_load(&wq->active_cnt), atomic_load(&wq->peak_cnt));
+    }
+
+    for (op = 0; op < OP_ID_END; op++) {
+        for (t = 0; t < NR_WQ_HIST; t++) {
+            h = &op_hist[op][t];
+            count = atomic_load(&h->count);
+            if (!count)
+                continue;
+
+            LOG_INFO("Opcode %2d %-7s: n %u, avg %llu, p50 %u, p90 %u, " \
+                     "p99 %u, max %u", op, hist_name[t], count, \
+                     atomic_load(&h->sum_us) / count, \
+                     wq_hist_percentile(h, 50), wq_hist_percentile(h, 90), \
+                     wq_hist_percentile(h, 99), atomic_load(&h->max_us));
+        }
+    }
+}
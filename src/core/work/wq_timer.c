@@ -0,0 +1,436 @@
+/**
+ * @file wq_timer.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+// #define LOG_LEVEL LOG_LEVEL_TRACE
+#if defined(LOG_LEVEL)
+#warning "LOG_LEVEL defined locally will override the global setting in this file"
+#endif
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "util.h"
+#include "sched/workqueue.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct wq_timer {
+    int32_t id;                         /* 0 while the slot is free */
+    uint64_t deadline_ns;
+    uint64_t period_ns;                 /* 0 for one-shot delayed work */
+    workqueue_t *wq;
+    work_t *work;                       /* One-shot: the work to queue */
+    work_factory_t factory;             /* Periodic: builds each instance */
+    void *arg;
+} wq_timer_t;
+
+/**********************
+ *  GLOBAL VARIABLES
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/*
+ * Pending timers, kept as a binary min-heap ordered by deadline. The only
+ * timerfd is always armed for the root, the timer thread sleeps on it.
+ */
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static wq_timer_t timer_slots[WQ_TIMER_MAX];
+static wq_timer_t *heap[WQ_TIMER_MAX];
+static int32_t nr_timers;
+static int32_t next_id = 1;
+static int32_t timer_fd = -1;
+static bool timer_run;
+static pthread_t timer_tid;
+/* Periodic timer whose factory runs unlocked right now, 0 if none */
+static int32_t firing_id;
+static pthread_cond_t firing_done = PTHREAD_COND_INITIALIZER;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void heap_swap(int32_t a, int32_t b)
+{
+    wq_timer_t *t = heap[a];
+
+    heap[a] = heap[b];
+    heap[b] = t;
+}
+
+static void heap_up(int32_t i)
+{
+    int32_t parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (heap[parent]->deadline_ns <= heap[i]->deadline_ns)
+            break;
+        heap_swap(parent, i);
+        i = parent;
+    }
+}
+
+static void heap_down(int32_t i)
+{
+    int32_t l, r, min;
+
+    for (;;) {
+        l = 2 * i + 1;
+        r = l + 1;
+        min = i;
+
+        if (l < nr_timers && heap[l]->deadline_ns < heap[min]->deadline_ns)
+            min = l;
+        if (r < nr_timers && heap[r]->deadline_ns < heap[min]->deadline_ns)
+            min = r;
+        if (min == i)
+            break;
+
+        heap_swap(min, i);
+        i = min;
+    }
+}
+
+static void heap_insert(wq_timer_t *t)
+{
+    heap[nr_timers] = t;
+    heap_up(nr_timers++);
+}
+
+static wq_timer_t *heap_remove(int32_t i)
+{
+    wq_timer_t *t = heap[i];
+
+    heap[i] = heap[--nr_timers];
+    if (i < nr_timers) {
+        heap_up(i);
+        heap_down(i);
+    }
+
+    return t;
+}
+
+/* Program the timerfd for the earliest deadline, or disarm it */
+static void timer_rearm(void)
+{
+    struct itimerspec its;
+    uint64_t deadline = 0;
+
+    memset(&its, 0, sizeof(its));
+    if (!timer_run)
+        deadline = 1;                   /* Already expired: wake the thread */
+    else if (nr_timers)
+        deadline = heap[0]->deadline_ns;
+
+    its.it_value.tv_sec = deadline / NSEC_PER_SEC;
+    its.it_value.tv_nsec = deadline % NSEC_PER_SEC;
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL)) {
+        LOG_ERROR("Failed to arm work timer: %s", strerror(errno));
+    }
+}
+
+static wq_timer_t *timer_slot_get(void)
+{
+    int32_t i;
+
+    for (i = 0; i < WQ_TIMER_MAX; i++) {
+        if (!timer_slots[i].id) {
+            memset(&timer_slots[i], 0, sizeof(timer_slots[i]));
+            timer_slots[i].id = next_id++;
+            if (next_id <= 0)
+                next_id = 1;
+            return &timer_slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int32_t timer_add(wq_timer_t *t, uint64_t delay_ns)
+{
+    int32_t id = t->id;
+
+    t->deadline_ns = now_ns() + delay_ns;
+    heap_insert(t);
+    if (heap[0] == t)
+        timer_rearm();
+
+    return id;
+}
+
+static void *timer_thread(void *arg __maybe_unused)
+{
+    wq_timer_t *t, fired;
+    uint64_t expirations, now;
+    work_t *w;
+    ssize_t len;
+
+    LOG_INFO("Work timer thread started");
+
+    for (;;) {
+        len = read(timer_fd, &expirations, sizeof(expirations));
+        if (len < 0 && errno != EINTR && errno != EAGAIN) {
+            LOG_ERROR("Work timer read failed: %s", strerror(errno));
+            break;
+        }
+
+        pthread_mutex_lock(&timer_lock);
+        while (timer_run && nr_timers && \
+               heap[0]->deadline_ns <= (now = now_ns())) {
+            t = heap[0];
+            fired = *t;
+
+            if (t->period_ns) {
+                /* Skip missed periods instead of firing a burst */
+                do {
+                    t->deadline_ns += t->period_ns;
+                } while (t->deadline_ns <= now);
+                heap_down(0);
+            } else {
+                heap_remove(0);
+                t->id = 0;
+            }
+
+            /* Build and queue without the lock, the factory may rearm */
+            if (fired.period_ns)
+                firing_id = fired.id;
+            pthread_mutex_unlock(&timer_lock);
+            w = fired.period_ns ? fired.factory(fired.arg) : fired.work;
+            if (w)
+                push_work(fired.wq, w);
+            pthread_mutex_lock(&timer_lock);
+
+            if (firing_id) {
+                firing_id = 0;
+                pthread_cond_broadcast(&firing_done);
+            }
+        }
+
+        if (!timer_run) {
+            pthread_mutex_unlock(&timer_lock);
+            break;
+        }
+
+        timer_rearm();
+        pthread_mutex_unlock(&timer_lock);
+    }
+
+    LOG_INFO("Work timer thread exited");
+    return NULL;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+/*
+ * queue_delayed_work - Queue @w on @wq once @delay_ms has elapsed
+ *
+ * The work is owned by the timer until it fires, it is released if the
+ * timer is cancelled or the workqueues are torn down first.
+ *
+ * Return: a positive timer id for cancel_timed_work(), or a negative errno.
+ * On error the caller still owns @w.
+ */
+int32_t queue_delayed_work(workqueue_t *wq, work_t *w, uint32_t delay_ms)
+{
+    wq_timer_t *t;
+    int32_t id;
+
+    if (wq == NULL || w == NULL) {
+        LOG_ERROR("Workqueue data is invalid");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&timer_lock);
+    if (!timer_run) {
+        pthread_mutex_unlock(&timer_lock);
+        return -ESHUTDOWN;
+    }
+
+    t = timer_slot_get();
+    if (!t) {
+        pthread_mutex_unlock(&timer_lock);
+        LOG_ERROR("No free work timer, limit %d", WQ_TIMER_MAX);
+        return -ENOSPC;
+    }
+
+    t->wq = wq;
+    t->work = w;
+    id = timer_add(t, (uint64_t)delay_ms * NSEC_PER_MSEC);
+    pthread_mutex_unlock(&timer_lock);
+
+    LOG_TRACE("Work opcode %d delayed by %u ms, timer %d", \
+              w->opcode, delay_ms, id);
+    return id;
+}
+
+/*
+ * queue_periodic_work - Queue a new work on @wq every @period_ms
+ * @factory: builds the work of each period, may return NULL to skip one
+ * @arg:     passed to @factory, must stay valid until the timer is cancelled
+ *
+ * The first work is queued one period from now. Periods that could not be
+ * served in time are skipped rather than queued back to back.
+ *
+ * Return: a positive timer id for cancel_timed_work(), or a negative errno.
+ */
+int32_t queue_periodic_work(workqueue_t *wq, work_factory_t factory, \
+                            void *arg, uint32_t period_ms)
+{
+    wq_timer_t *t;
+    int32_t id;
+
+    if (wq == NULL || factory == NULL || period_ms == 0) {
+        LOG_ERROR("Periodic work data is invalid");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&timer_lock);
+    if (!timer_run) {
+        pthread_mutex_unlock(&timer_lock);
+        return -ESHUTDOWN;
+    }
+
+    t = timer_slot_get();
+    if (!t) {
+        pthread_mutex_unlock(&timer_lock);
+        LOG_ERROR("No free work timer, limit %d", WQ_TIMER_MAX);
+        return -ENOSPC;
+    }
+
+    t->wq = wq;
+    t->factory = factory;
+    t->arg = arg;
+    t->period_ns = (uint64_t)period_ms * NSEC_PER_MSEC;
+    id = timer_add(t, t->period_ns);
+    pthread_mutex_unlock(&timer_lock);
+
+    LOG_TRACE("Periodic work every %u ms, timer %d", period_ms, id);
+    return id;
+}
+
+/*
+ * cancel_timed_work - Stop a delayed or periodic work timer
+ *
+ * A delayed work that has not fired yet is released. A periodic factory
+ * already running is waited for, so its arg may be freed once this
+ * returns. The work it built is still queued. Called from the factory
+ * itself, this returns without waiting.
+ *
+ * Return: 0 on success, -ENOENT if the timer already fired or is unknown.
+ */
+int32_t cancel_timed_work(int32_t id)
+{
+    wq_timer_t *t = NULL;
+    int32_t i;
+
+    pthread_mutex_lock(&timer_lock);
+    for (i = 0; i < nr_timers; i++) {
+        if (heap[i]->id == id) {
+            t = heap_remove(i);
+            break;
+        }
+    }
+
+    if (!t) {
+        pthread_mutex_unlock(&timer_lock);
+        return -ENOENT;
+    }
+
+    if (i == 0)
+        timer_rearm();
+
+    if (t->work)
+        delete_work(t->work);
+    t->id = 0;
+
+    if (!pthread_equal(pthread_self(), timer_tid)) {
+        while (firing_id == id)
+            pthread_cond_wait(&firing_done, &timer_lock);
+    }
+    pthread_mutex_unlock(&timer_lock);
+
+    return 0;
+}
+
+int32_t wq_timer_init(void)
+{
+    int32_t ret;
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        LOG_FATAL("Failed to create work timer: %s", strerror(errno));
+        return -errno;
+    }
+
+    nr_timers = 0;
+    firing_id = 0;
+    timer_run = true;
+
+    ret = pthread_create(&timer_tid, NULL, timer_thread, NULL);
+    if (ret) {
+        LOG_FATAL("Failed to create work timer thread: %s", strerror(ret));
+        timer_run = false;
+        close(timer_fd);
+        timer_fd = -1;
+        return -ret;
+    }
+
+    return 0;
+}
+
+/* Stop the timer thread and drop every pending timer with its work */
+void wq_timer_deinit(void)
+{
+    wq_timer_t *t;
+
+    if (timer_fd < 0)
+        return;
+
+    pthread_mutex_lock(&timer_lock);
+    timer_run = false;
+    timer_rearm();
+    pthread_mutex_unlock(&timer_lock);
+
+    pthread_join(timer_tid, NULL);
+
+    pthread_mutex_lock(&timer_lock);
+    while (nr_timers) {
+        t = heap_remove(nr_timers - 1);
+        if (t->work)
+            delete_work(t->work);
+        t->id = 0;
+    }
+    pthread_mutex_unlock(&timer_lock);
+
+    close(timer_fd);
+    timer_fd = -1;
+}
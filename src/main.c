@@ -24,15 +24,22 @@
 
 #include "ui/ui_core.h"
 #include "ui/screen.h"
+#include "ui/ui_lane.h"
 #include "comm/cmd_payload.h"
 #include "comm/f_comm.h"
 #include "comm/dbus_comm.h"
+#include "comm/dbus_req.h"
+#include "mem/obj_pool.h"
 #include "sched/workqueue.h"
 #include "main.h"
 
 /*********************
  *      DEFINES
  *********************/
+#define BACKLIGHT_ON_DELAY_MS           200
+#define BACKLIGHT_OFF_TIMEOUT_MS        3000
+#define SHUTDOWN_DRAIN_MS               3000
+#define SHUTDOWN_DRAIN_SLICE_MS         10
 
 /**********************
  *      TYPEDEFS
@@ -73,6 +80,10 @@ static void sig_handler(int32_t sig)
             LOG_WARN("[+] Received SIGABRT. Exiting...");
             event_set(get_ctx()->comm.event, SIGABRT);
             break;
+        case SIGUSR2:
+            /* Dumped from the DBus listener, not in signal context */
+            event_set(get_ctx()->comm.event, SIGUSR2);
+            break;
         default:
             LOG_WARN("[!] Received unidentified signal: %d", sig);
             break;
@@ -96,6 +107,11 @@ static int32_t setup_signal_handler()
         return -EIO;
     }
 
+    if (signal(SIGUSR2, sig_handler) == SIG_ERR) {
+        LOG_ERROR("Error registering signal SIGUSR2 handler");
+        return -EIO;
+    }
+
     return 0;
 }
 
@@ -106,6 +122,8 @@ static int32_t create_ctx(void)
         return -ENOMEM;
     }
 
+    INIT_LIST_HEAD(&runtime_ctx->op.handler_lst);
+
     return 0;
 }
 
@@ -121,6 +139,8 @@ static int32_t service_startup_flow(void)
 {
     int32_t ret;
     pthread_t dbus_handler;
+    remote_cmd_t *cmd;
+    wq_conf_t wq_conf;
     ctx_t *ctx;
 
     ctx = get_ctx();
@@ -145,25 +165,35 @@ static int32_t service_startup_flow(void)
         goto exit_ui;
     }
 
-    ret = workqueue_init();
+    workqueue_default_conf(&wq_conf);
+    ret = workqueue_init(&wq_conf);
     if (ret) {
         LOG_FATAL("Failed to initialize workqueues, ret=%d", ret);
         goto exit_event;
     }
 
+    /* Opcode routes must be known before the first frame is decoded */
+    ret = task_handlers_init();
+    if (ret) {
+        LOG_FATAL("Failed to register opcode handlers, ret=%d", ret);
+        goto exit_workqueue;
+    }
+
     /* Create DBus listener thread */
     ret = pthread_create(&dbus_handler, NULL, dbus_fn_thread_handler, NULL);
     if (ret) {
         LOG_FATAL("Failed to create DBus listener thread: %s", strerror(ret));
-        goto exit_workqueue;
+        goto exit_handlers;
     }
 
-    /* Optional delay before sending remote task */
-    usleep(200000);
-
-    /* Turn on backlight via remote task */
-    ret = create_remote_simple_task(WORK_PRIO_NORMAL, WORK_DURATION_SHORT, \
-                                    OP_ENA_BACKLIGHT);
+    /*
+     * Turn on backlight via remote task, delayed so the DBus listener is
+     * connected before the request is sent. Startup goes on meanwhile.
+     */
+    cmd = create_remote_task_data(WORK_PRIO_NORMAL, WORK_DURATION_SHORT, \
+                                  OP_ENA_BACKLIGHT);
+    ret = cmd ? create_remote_delayed_task(WORK_PRIO_HIGH, cmd, \
+                                           BACKLIGHT_ON_DELAY_MS) : -ENOMEM;
     if (ret) {
         LOG_ERROR("Failed to create remote task: backlight on");
         goto exit_dbus;
@@ -176,6 +206,9 @@ static int32_t service_startup_flow(void)
 exit_dbus:
     event_set(get_ctx()->comm.event, SIGUSR1);
 
+exit_handlers:
+    task_handlers_deinit();
+
 exit_workqueue:
     workqueue_deinit();
 
@@ -198,31 +231,57 @@ exit_err:
  */
 static void service_shutdown_flow(void)
 {
-    int32_t ret;
-    int32_t cnt;
+    int32_t ret, result = 0, i;
+    work_handle_t *backlight_off;
+    remote_cmd_t *cmd;
     ctx_t *ctx = get_ctx();
 
-    /* Turn off backlight via remote task */
-    ret = create_remote_simple_task(WORK_PRIO_NORMAL, WORK_DURATION_LONG, \
-                                    OP_DIS_BACKLIGHT);
-    if (ret) {
+    /* Turn off backlight and wait for the peer to confirm it */
+    cmd = create_remote_task_data(WORK_PRIO_NORMAL, WORK_DURATION_LONG, \
+                                  OP_DIS_BACKLIGHT);
+    backlight_off = cmd ? dbus_request(WORK_PRIO_HIGH, cmd, \
+                                       BACKLIGHT_OFF_TIMEOUT_MS, NULL, NULL) \
+                        : NULL;
+    if (!backlight_off) {
         LOG_ERROR("Failed to create remote task: backlight off");
         return;
     }
 
-    /* Wait until workqueue is fully drained */
-    cnt = workqueue_active_count(get_wq(UI_WQ));
-    while (cnt) {
-        LOG_TRACE("Waiting for workqueue to be free, remaining work %d", cnt);
-        usleep(100000);
-        cnt = workqueue_active_count(get_wq(UI_WQ));
+    /* Bounded here as well, shutdown must not depend on the request tick */
+    ret = work_wait(backlight_off, BACKLIGHT_OFF_TIMEOUT_MS + \
+                    DBUS_REQ_TICK_MS, &result);
+    if (ret || result) {
+        LOG_WARN("Backlight off not confirmed, ret %d, result %d", \
+                 ret, result);
+    }
+    work_handle_put(backlight_off);
+
+    /*
+     * Wait until workqueue is drained. This runs on the UI thread, workers
+     * waiting for room in the UI lane need it served meanwhile.
+     */
+    LOG_TRACE("Waiting for workqueue to be free, remaining work %d", \
+              workqueue_active_count(get_wq(UI_WQ)));
+    for (i = 0; i < SHUTDOWN_DRAIN_MS / SHUTDOWN_DRAIN_SLICE_MS; i++) {
+        ui_lane_drain();
+        ret = workqueue_drain(get_wq(UI_WQ), SHUTDOWN_DRAIN_SLICE_MS);
+        if (!ret)
+            break;
+    }
+    if (ret) {
+        LOG_WARN("Workqueue not drained, remaining work %d", \
+                 workqueue_active_count(get_wq(UI_WQ)));
     }
 
     /* Stop background threads and notify shutdown */
     get_ctx()->run = 0;                 /* Signal threads to stop */
     event_set(get_ctx()->comm.event, SIGINT);    /* Notify DBus/system about shutdown */
 
+    /* Nothing will read the replies anymore */
+    dbus_req_cancel_all(-ESHUTDOWN);
     workqueue_deinit();
+    task_handlers_deinit();
+    obj_pool_dump_stats();
 
     cleanup_event_file(ctx);
 
@@ -235,6 +294,7 @@ static int32_t main_loop()
 {
     LOG_INFO("Terminal UI service is running...");
     while (get_ctx()->run) {
+        ui_lane_drain();
         lv_task_handler();
         usleep(5000);
     };
@@ -15,9 +15,12 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+#include "util.h"
 #include "ui/screen.h"
+#include "ui/windows.h"
 #include "comm/dbus_comm.h"
 #include "comm/cmd_payload.h"
+#include "sched/op_handler.h"
 #include "sched/workqueue.h"
 #include "main.h"
 
@@ -40,6 +43,45 @@
 /**********************
  *  STATIC VARIABLES
  **********************/
+/*
+ * Opcodes this service handles. State reports go through the UI workqueue
+ * with the priority of their frame, the periodic ones only matter in their
+ * latest version.
+ */
+static op_entry_t task_handlers[] = {
+    {
+        .opcode = OP_DBUS_SENT_CMD,
+        .fn = (op_fn_t)dbus_method_call_with_data,
+        .wq = UI_WQ,
+        .prio = OP_PRIO_FRAME,
+    },
+    {
+        .opcode = OP_BACKLIGHT_STATE,
+        .fn = (op_fn_t)handle_backlight_state,
+        .wq = UI_WQ,
+        .prio = OP_PRIO_FRAME,
+    },
+    {
+        .opcode = OP_WIFI_STATE,
+        .fn = (op_fn_t)handle_wifi_state,
+        .wq = UI_WQ,
+        .prio = OP_PRIO_FRAME,
+    },
+    {
+        .opcode = OP_WIFI_AP_LIST,
+        .fn = (op_fn_t)handle_wifi_access_point,
+        .wq = UI_WQ,
+        .prio = OP_PRIO_FRAME,
+        .flags = OP_F_COALESCE,
+    },
+    {
+        .opcode = OP_IMU_STATE,
+        .fn = (op_fn_t)handle_imu_rotation_state,
+        .wq = UI_WQ,
+        .prio = OP_PRIO_FRAME,
+        .flags = OP_F_COALESCE | OP_F_DROPPABLE,
+    },
+};
 
 /**********************
  *      MACROS
@@ -52,31 +94,27 @@
 /**********************
  *   GLOBAL FUNCTIONS
  **********************/
-int32_t process_opcode(uint32_t opcode, void *data)
+int32_t task_handlers_init(void)
 {
-    int32_t ret = 0;
+    int32_t i, ret;
 
-    switch (opcode) {
-    case OP_DBUS_SENT_CMD:
-        ret = dbus_method_call_with_data((remote_cmd_t *)data);
-        break;
-    case OP_BACKLIGHT_STATE:
-        ret = handle_backlight_state((remote_cmd_t *)data);
-        break;
-    case OP_WIFI_STATE:
-        ret = handle_wifi_state((remote_cmd_t *)data);
-        break;
-    case OP_WIFI_AP_LIST:
-        ret = handle_wifi_access_point((remote_cmd_t *)data);
-        break;
-    case OP_IMU_STATE:
-        ret = handle_imu_rotation_state((remote_cmd_t *)data);
-        break;
-    default:
-        LOG_ERROR("Opcode [%d] is invalid", opcode);
-        break;
+    for (i = 0; i < ARRAY_SIZE(task_handlers); i++) {
+        ret = op_register(&task_handlers[i]);
+        if (ret) {
+            op_unregister_all();
+            return ret;
+        }
     }
 
-    return ret;
+    return 0;
+}
+
+void task_handlers_deinit(void)
+{
+    op_unregister_all();
 }
 
+int32_t process_opcode(uint32_t opcode, void *data)
+{
+    return op_run(opcode, data);
+}
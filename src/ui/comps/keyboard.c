@@ -629,7 +629,7 @@ int32_t create_keys_layout(lv_obj_t *par, const keyboard_def *map)
         /* set_key_size(btn, &map->key[i], &size); */
         set_key_color(btn, &map->key[i]);
         set_internal_data(btn, (void *)&map->key[i]);
-        line_w += size.k_pad_left + get_meta(btn)->size.w + size.k_pad_right;
+        line_w += size.k_pad_left + get_w(btn) + size.k_pad_right;
     }
 
     return 0;
@@ -683,7 +683,7 @@ int32_t update_keys_layout(lv_obj_t *par, const keyboard_def *map)
             //     LOG_ERROR("line box [%s] not found", map->key[i].label);
             //     return -EINVAL;
             /************** SOMETHING WRONG AT THE ABOVE OF THIS *************/
-            get_meta(line_box)->data.rotation = ROTATION_0;
+            set_meta_rotation(get_meta(line_box), ROTATION_0);
 
             continue;
         }
@@ -716,10 +716,10 @@ int32_t update_keys_layout(lv_obj_t *par, const keyboard_def *map)
         set_pos_center(btn_lbl);
 
         // Reset key configurations to the horizontal map.
-        get_meta(btn)->data.rotation = ROTATION_0;
-        get_meta(btn_lbl)->data.rotation = ROTATION_0;
+        set_meta_rotation(get_meta(btn), ROTATION_0);
+        set_meta_rotation(get_meta(btn_lbl), ROTATION_0);
 
-        line_w += size.k_pad_left + get_meta(btn)->size.w + size.k_pad_right;
+        line_w += size.k_pad_left + get_w(btn) + size.k_pad_right;
     }
 
     return 0;
@@ -868,7 +868,7 @@ int32_t pre_rotation_redraw_kb_layout(lv_obj_t *kb)
 
     // Reset all keyboard configurations to the horizontal layout.
     set_size(kb, obj_w, obj_h);
-    get_meta(kb)->data.rotation = ROTATION_0;
+    set_meta_rotation(get_meta(kb), ROTATION_0);
     set_align_scale(kb, par, LV_ALIGN_BOTTOM_MID, 0, -KEYBOARD_PAD_BOT);
 
     // TODO: map?
@@ -21,6 +21,7 @@
 #include <lvgl.h>
 #include "list.h"
 #include "ui/ui_core.h"
+#include "ui/ui_lane.h"
 #include "ui/fonts.h"
 #include "ui/comps.h"
 #include "ui/windows.h"
@@ -120,6 +121,10 @@ int32_t ui_main_init(ctx_t *ctx)
 
     ctx->objs.next_id = 1;
 
+    ret = ui_lane_init();
+    if (ret)
+        return ret;
+
     set_scr_size(DISP_WIDTH, DISP_HEIGHT);
 
     // Initialize LVGL and the associated UI hardware
@@ -191,5 +196,6 @@ int32_t ui_main_init(ctx_t *ctx)
 
 void ui_main_deinit(ctx_t *ctx)
 {
+    ui_lane_deinit();
     destroy_ui_object_ctx(ctx);
 }
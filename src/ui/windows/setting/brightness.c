@@ -21,6 +21,7 @@
 #include <lvgl.h>
 #include "list.h"
 #include "ui/ui_core.h"
+#include "ui/ui_lane.h"
 #include "ui/fonts.h"
 #include "ui/comps.h"
 #include "ui/windows.h"
@@ -49,6 +50,7 @@
  **********************/
 static lv_obj_t *brightness_slider = NULL;
 static lv_obj_t *als_switch = NULL;
+static work_handle_t *brightness_req = NULL;    /* Last adjust request */
 
 /**********************
  *      MACROS
@@ -81,13 +83,23 @@ static int32_t req_set_brightness(int32_t value)
         return -EINVAL;
     }
 
-    if (remote_cmd_add_int(cmd, "brightness", value)) {
+    if (remote_cmd_add_i32(cmd, KEY_BRIGHTNESS, value)) {
         delete_remote_cmd(cmd);
         return -EIO;
     }
 
+    /* While the slider is dragged, only the latest value is worth sending */
+    if (brightness_req) {
+        work_cancel(brightness_req);
+        work_handle_put(brightness_req);
+    }
+
     // NOTE: Command data will be released after the work completes
-    return create_remote_task(WORK_PRIO_HIGH, cmd);
+    brightness_req = create_remote_tracked_task(WORK_PRIO_HIGH, cmd);
+    if (!brightness_req)
+        return -EINVAL;
+
+    return 0;
 }
 
 static void set_brightness_runtime_slider(int32_t value)
@@ -185,6 +197,20 @@ static void manual_brightness_event_handler(lv_event_t *e)
         LOG_ERROR("Set brightness failed, ret %d", ret);
 }
 
+/*
+ * Page teardown: forget the slider and release the last adjust request.
+ * The request itself is left to complete, it carries the final value.
+ */
+static void brightness_slider_delete_event_handler(lv_event_t *e)
+{
+    brightness_slider = NULL;
+
+    if (brightness_req) {
+        work_handle_put(brightness_req);
+        brightness_req = NULL;
+    }
+}
+
 static int32_t create_setting_items(lv_obj_t *par)
 {
     lv_obj_t *group, *sym, *label, *switch_box;
@@ -244,7 +270,9 @@ static int32_t create_setting_items(lv_obj_t *par)
     lv_obj_set_style_anim_duration(brightness_slider, 500, 0);
     lv_obj_add_event_cb(brightness_slider, manual_brightness_event_handler, \
                         LV_EVENT_VALUE_CHANGED, NULL);
-
+    lv_obj_add_event_cb(brightness_slider, \
+                        brightness_slider_delete_event_handler, \
+                        LV_EVENT_DELETE, NULL);
 
     sym = create_symbol_box(group, NULL, &terminal_icons_32, \
                             ICON_CIRCLE_PLUS_SOLID);
@@ -311,34 +339,39 @@ err_ctx:
 
 /*
  * Handle backlight state command.
- * Expected command entries:
- *   [0]: "als_enable"  -> 1 = enabled, 0 = disabled
- *   [1]: "brightness"  -> brightness level
+ * Expected command entries, in any order:
+ *   KEY_ALS_ENABLE  -> 1 = enabled, 0 = disabled
+ *   KEY_BRIGHTNESS  -> brightness level
+ * Legacy frames may carry them as entries [0] and [1] instead.
  */
 int32_t handle_backlight_state(remote_cmd_t *cmd)
 {
     bool als_enabled;
-    int32_t brightness;
+    int32_t als, brightness;
     int32_t ret = 0;
 
     if (!cmd)
         return -EINVAL;
 
-    als_enabled = !!cmd->entries[0].value.i32;
-    brightness = cmd->entries[1].value.i32;
+    ret = remote_cmd_get_i32_at(cmd, KEY_ALS_ENABLE, 0, &als);
+    if (!ret)
+        ret = remote_cmd_get_i32_at(cmd, KEY_BRIGHTNESS, 1, &brightness);
+    if (ret) {
+        LOG_ERROR("Malformed backlight state, ret=%d", ret);
+        return ret;
+    }
+    als_enabled = !!als;
 
-    LOG_TRACE("ALS status: key=[%s], value=[%d]", \
-              cmd->entries[0].key, als_enabled);
-    LOG_TRACE("Brightness: key=[%s], value=[%d]", \
-              cmd->entries[1].key, brightness);
+    LOG_TRACE("ALS status: value=[%d]", als_enabled);
+    LOG_TRACE("Brightness: value=[%d]", brightness);
 
-    /* Async update to avoid blocking UI thread */
+    /* Applied by the UI thread on its next frame */
     if (als_enabled)
-        lv_async_call((lv_async_cb_t)enable_als_page_update, \
-                      (void *)(intptr_t)brightness);
+        ui_post((ui_cb_t)enable_als_page_update, \
+                (void *)(intptr_t)brightness);
     else
-        lv_async_call((lv_async_cb_t)disable_als_page_update, \
-                      (void *)(intptr_t)brightness);
+        ui_post((ui_cb_t)disable_als_page_update, \
+                (void *)(intptr_t)brightness);
 
     return ret;
 }
@@ -15,12 +15,14 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <errno.h>
 
 #include <lvgl.h>
 #include "list.h"
 #include "ui/ui_core.h"
+#include "ui/ui_lane.h"
 #include "ui/fonts.h"
 #include "ui/comps.h"
 #include "ui/windows.h"
@@ -49,6 +51,8 @@
  *  STATIC VARIABLES
  **********************/
 static lv_obj_t *rotation_switch = NULL;
+/* Switch state posted to the UI, IMU reports run on several workers */
+static _Atomic int32_t shown_imu_ena = -1;
 
 /**********************
  *      MACROS
@@ -177,6 +181,8 @@ lv_obj_t *create_rotation_setting(lv_obj_t *par, const char *name, \
         goto err_view;
     }
 
+    /* The new switch starts unchecked, force the next report through */
+    atomic_store(&shown_imu_ena, -1);
     ret = req_imu_state();
     if (ret)
         LOG_WARN("Unable to sync the latest configuration, ret %d", ret);
@@ -232,15 +238,19 @@ int32_t handle_imu_rotation_state(remote_cmd_t *cmd)
 {
     int32_t imu_ena, roll, pitch, yaw;
     int8_t rotation = -1;
-    static int8_t prev_rot = ROTATION_0;
+    static _Atomic int8_t prev_rot = ROTATION_0;
 
     if (!cmd)
         return -EINVAL;
 
-    imu_ena = cmd->entries[0].value.i32;
-    roll  = cmd->entries[1].value.i32;
-    pitch = cmd->entries[2].value.i32;
-    yaw   = cmd->entries[3].value.i32;
+    /* Legacy frames: enable, roll, pitch, yaw */
+    if (remote_cmd_get_i32_at(cmd, KEY_IMU_ENABLE, 0, &imu_ena) || \
+        remote_cmd_get_i32_at(cmd, KEY_IMU_ROLL, 1, &roll) || \
+        remote_cmd_get_i32_at(cmd, KEY_IMU_PITCH, 2, &pitch) || \
+        remote_cmd_get_i32_at(cmd, KEY_IMU_YAW, 3, &yaw)) {
+        LOG_ERROR("Malformed IMU state");
+        return -EPROTO;
+    }
 
     /* Determine rotation angle from IMU data */
     if (roll < -45)
@@ -253,20 +263,19 @@ int32_t handle_imu_rotation_state(remote_cmd_t *cmd)
         rotation = ROTATION_0;
 
     /* Apply new rotation if changed */
-    if (rotation != -1 && rotation != prev_rot) {
-        prev_rot = rotation;
+    if (rotation != -1 && atomic_exchange(&prev_rot, rotation) != rotation) {
         set_scr_rotation(rotation);
 
-        lv_async_call((lv_async_cb_t)update_rotation_switch_state, \
-                      (void *)(intptr_t)imu_ena);
-        lv_async_call((lv_async_cb_t)refresh_screen_rotation, NULL);
+        ui_post((ui_cb_t)refresh_screen_rotation, NULL);
 
         LOG_INFO("Rotation changed to %d (r=%d, p=%d, y=%d)", \
                  rotation, roll, pitch, yaw);
-    } else {
-        // TODO: reduce path
-        lv_async_call((lv_async_cb_t)update_rotation_switch_state, \
-                      (void *)(intptr_t)imu_ena);
+    }
+
+    /* Periodic reports mostly repeat the same state, skip the UI round trip */
+    if (atomic_exchange(&shown_imu_ena, imu_ena) != imu_ena) {
+        ui_post((ui_cb_t)update_rotation_switch_state, \
+                (void *)(intptr_t)imu_ena);
     }
 
     return 0;
@@ -20,13 +20,16 @@
 
 #include <lvgl.h>
 #include "list.h"
+#include "util.h"
 #include "ui/ui_core.h"
+#include "ui/ui_lane.h"
 #include "ui/fonts.h"
 #include "ui/comps.h"
 #include "ui/windows.h"
 #include "ui/widget/menu.h"
 #include "sched/workqueue.h"
 #include "comm/cmd_payload.h"
+#include "comm/dbus_req.h"
 #include "comm/net/network.h"
 
 /*********************
@@ -63,30 +66,46 @@ static wifi_info_t wifi_state;
 /**********************
  *   STATIC FUNCTIONS
  **********************/
-static int32_t req_wifi_state()
+static void wifi_req_done(int32_t result, void *arg __maybe_unused)
+{
+    if (result) {
+        LOG_WARN("Wi-Fi request opcode %d failed, ret %d", \
+                 (int32_t)(intptr_t)arg, result);
+    }
+}
+
+/*
+ * Both requests are in flight together, their data comes back as separate
+ * commands. Only the outcome of the calls is followed here.
+ */
+static int32_t req_wifi_sync(uint32_t opcode)
 {
+    work_handle_t *h;
     remote_cmd_t *cmd;
 
     cmd = create_remote_task_data(WORK_PRIO_NORMAL, WORK_DURATION_SHORT, \
-                                  OP_WIFI_STATE);
+                                  opcode);
     if (!cmd)
         return -ENOMEM;
 
     // NOTE: Command data will be released after the work completes
-    return create_remote_task(WORK_PRIO_HIGH, cmd);
+    h = dbus_request(WORK_PRIO_HIGH, cmd, 0, wifi_req_done, \
+                     (void *)(intptr_t)opcode);
+    if (!h)
+        return -EIO;
+
+    work_handle_put(h);
+    return 0;
 }
 
-static int32_t req_cached_ap_list()
+static int32_t req_wifi_state()
 {
-    remote_cmd_t *cmd;
-
-    cmd = create_remote_task_data(WORK_PRIO_NORMAL, WORK_DURATION_SHORT, \
-                                  OP_WIFI_AP_LIST);
-    if (!cmd)
-        return -ENOMEM;
+    return req_wifi_sync(OP_WIFI_STATE);
+}
 
-    // NOTE: Command data will be released after the work completes
-    return create_remote_task(WORK_PRIO_HIGH, cmd);
+static int32_t req_cached_ap_list()
+{
+    return req_wifi_sync(OP_WIFI_AP_LIST);
 }
 
 /*
@@ -388,42 +407,63 @@ int32_t runtime_add_wifi_connected_ap(int8_t strength)
 int32_t handle_wifi_state(remote_cmd_t *cmd)
 {
     bool wifi_enabled;
-    const char *active_ap;
-    int32_t signal_strength;
+    const char *active_ap = NULL;
+    int32_t signal_strength = 0;
+    int32_t enabled, i;
     int32_t ret = 0;
 
     if (!cmd)
         return -EINVAL;
 
-    wifi_enabled = !!cmd->entries[0].value.i32;
-    active_ap = cmd->entries[1].key;
-    signal_strength = cmd->entries[1].value.i32;
+    if (remote_cmd_get_i32_at(cmd, KEY_WIFI_ENABLE, 0, &enabled)) {
+        LOG_ERROR("Malformed Wi-Fi state");
+        return -EPROTO;
+    }
+    wifi_enabled = !!enabled;
+
+    /*
+     * The connected AP is sent with its SSID as key. Legacy frames have it
+     * right after the enable entry, whatever that one is named.
+     */
+    if (!cmd->key_slot[KEY_WIFI_ENABLE]) {
+        if (cmd->entry_count > 1) {
+            active_ap = cmd->entries[1].key;
+            signal_strength = cmd->entries[1].value.i32;
+        }
+    } else {
+        for (i = 0; i < cmd->entry_count; i++) {
+            if (cmd->entries[i].key_id == KEY_NONE) {
+                active_ap = cmd->entries[i].key;
+                signal_strength = cmd->entries[i].value.i32;
+                break;
+            }
+        }
+    }
 
-    LOG_INFO("Wi-Fi status: key=[%s], value=[%d]", \
-             cmd->entries[0].key, wifi_enabled);
+    LOG_INFO("Wi-Fi status: value=[%d]", wifi_enabled);
 
     if (wifi_enabled)
         LOG_INFO("Wi-Fi connected AP: SSID [%s] - Strength [%d]", \
                  active_ap ? active_ap : "(null)", signal_strength);
 
-    /* Async update to avoid blocking UI thread */
-    lv_async_call((lv_async_cb_t)tongle_wifi_switch_page_update, \
-                  (void *)(intptr_t)wifi_enabled);
+    /* Applied by the UI thread on its next frame */
+    ui_post((ui_cb_t)tongle_wifi_switch_page_update, \
+            (void *)(intptr_t)wifi_enabled);
 
     if (wifi_enabled && active_ap && *active_ap) {
         strncpy(active_ap_ssid, active_ap, sizeof(active_ap_ssid) - 1);
         active_ap_ssid[sizeof(active_ap_ssid) - 1] = '\0';
 
-        lv_async_call((lv_async_cb_t)runtime_add_wifi_connected_ap, \
-                      (void *)(intptr_t)signal_strength);
+        ui_post((ui_cb_t)runtime_add_wifi_connected_ap, \
+                (void *)(intptr_t)signal_strength);
     } else {
         if (lv_obj_is_valid(wifi_connected_ap)) {
-            lv_async_call(remove_wifi_connected_access_point, \
-                          wifi_connected_ap);
+            ui_post((ui_cb_t)remove_wifi_connected_access_point, \
+                    wifi_connected_ap);
         }
 
         if (lv_obj_is_valid(ap_holder)) {
-            lv_async_call(remove_all_wifi_access_point, ap_holder);
+            ui_post((ui_cb_t)remove_all_wifi_access_point, ap_holder);
         }
     }
 
@@ -435,12 +475,13 @@ int32_t handle_wifi_state(remote_cmd_t *cmd)
  */
 void refresh_available_access_point_holder(void *unused)
 {
+    ap_list_t *list = wifi_state.cached;
     int32_t ret;
     const char *ssid;
     int8_t strength;
     int32_t i;
 
-    LOG_DEBUG("Create [%d] Wi-Fi AP", wifi_state.ap_count);
+    LOG_DEBUG("Create [%d] Wi-Fi AP", list ? list->count : 0);
 
     if (!lv_obj_is_valid(ap_holder)) {
         LOG_ERROR("Wi-Fi access point holder is not available");
@@ -453,9 +494,9 @@ void refresh_available_access_point_holder(void *unused)
         return;
     }
 
-    for (i = 0; i < wifi_state.ap_count; ++i) {
-        ssid = wifi_state.cached_ap[i].ssid;
-        strength = wifi_state.cached_ap[i].strength;
+    for (i = 0; list && i < list->count; ++i) {
+        ssid = list->ap[i].ssid;
+        strength = list->ap[i].strength;
 
         LOG_TRACE("Wi-Fi AP holder add: SSID [%s] - strength [%d]", \
                   ssid && *ssid ? ssid : "Unknown", strength);
@@ -472,38 +513,52 @@ void refresh_available_access_point_holder(void *unused)
     }
 }
 
+/*
+ * Replace the cached scan result, on the UI thread so the list being drawn
+ * is never freed under it.
+ */
+static void install_access_point_list(ap_list_t *list)
+{
+    free(wifi_state.cached);
+    wifi_state.cached = list;
+
+    refresh_available_access_point_holder(NULL);
+}
+
 /*
  * Handle Wi-Fi access point command.
  */
 int32_t handle_wifi_access_point(remote_cmd_t *cmd)
 {
+    ap_list_t *list;
     int32_t ret = 0;
     int32_t i;
 
     if (!cmd)
         return -EINVAL;
 
-    wifi_state.ap_count = cmd->entry_count;
-    LOG_DEBUG("Available Wi-Fi Access point: Count=[%d]", wifi_state.ap_count);
+    LOG_DEBUG("Available Wi-Fi Access point: Count=[%d]", cmd->entry_count);
 
-    for (i = 0; i < cmd->entry_count; ++i) {
+    list = calloc(1, sizeof(*list) + cmd->entry_count * sizeof(list->ap[0]));
+    if (!list)
+        return -ENOMEM;
+
+    list->count = cmd->entry_count;
+    for (i = 0; i < list->count; ++i) {
         const payload_t *entry = &cmd->entries[i];
         const char *key = entry->key ? entry->key : "";
 
-        memset(wifi_state.cached_ap[i].ssid, 0, \
-               sizeof(wifi_state.cached_ap[i].ssid));
-
-        strncpy(wifi_state.cached_ap[i].ssid, key, \
-                sizeof(wifi_state.cached_ap[i].ssid) - 1);
-
-        wifi_state.cached_ap[i].strength = entry->value.i32;
+        strncpy(list->ap[i].ssid, key, sizeof(list->ap[i].ssid) - 1);
+        list->ap[i].strength = entry->value.i32;
 
         LOG_TRACE("Clone Wi-Fi AP: SSID [%s] - strength [%d]", \
                   key[0] ? key : "UNKNOWN", entry->value.i32);
     }
 
-    /* Async refresh UI after state updated */
-    lv_async_call(refresh_available_access_point_holder, NULL);
+    /* Refresh UI on the next frame after state updated */
+    ret = ui_post((ui_cb_t)install_access_point_list, list);
+    if (ret)
+        free(list);
 
     return ret;
 }